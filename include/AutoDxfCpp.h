@@ -1,6 +1,8 @@
 #pragma once
 
 #include <QtWidgets/QMainWindow>
+#include <QProgressBar>
+#include <QLabel>
 #include "ui_AutoDxfCpp.h"
 #include "myqopenglwidget.h"
 
@@ -15,15 +17,26 @@ public:
 	MyQOpenGLWidget* getOglWidget() const { return m_oglWidget; }
 
 private:
+	// Checkable "Layers" branch of the tree, one item per layer
+	void addLayerTree(QStandardItemModel* model);
+	void syncLayerChecks();
+
 	Ui::AutoDxfCppClass ui;
 	MyQOpenGLWidget* m_oglWidget;
+	QProgressBar* m_loadProgress;
+	QLabel* m_loadReportLabel;
+	QStandardItem* m_layerRoot = nullptr;
 	bool m_showMenu;
 
 private slots:
 	void OnLoadDxf();
 	void OnSplit();
 	void OnMouseMoved(const QPointF& pos);
+	void OnLoadProgress(qint64 bytesRead, qint64 totalBytes);
+	void OnLoadFinished(bool success);
 	void OnUpdateTreeModel(QStandardItemModel* model);
 	void onTreeItemClicked(const QModelIndex& index);
+	void onTreeItemDoubleClicked(const QModelIndex& index);
+	void onTreeItemChanged(QStandardItem* item);
 	void onEntitySelectedInViewport(Entity* entity);
 };
\ No newline at end of file
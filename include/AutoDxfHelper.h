@@ -1,3 +1,6 @@
+#pragma once
+#include <memory>
+#include <string>
 #include <glm/glm.hpp>
 #include <Entities/Polyline.h>
 
@@ -6,6 +9,11 @@ class AutoDxfHelper
 public:
 	static constexpr float EPSILON = 1e-6f;
 
+	// Chord (sagitta) error in world units for curves tessellated before the
+	// view scale is known; one world unit is one pixel at zoom 1.
+	static constexpr float DEFAULT_CHORD_TOLERANCE = 0.25f;
+	static constexpr int MAX_ARC_SEGMENTS = 4096;
+
 	static bool IsZero(float value) {
 		return std::abs(value) <= EPSILON;
 	}
@@ -33,6 +41,22 @@ public:
 
     static float RadiusFromBulge(const glm::vec2& p1, const glm::vec2& p2, float bulge);
 
+    // Number of segments so the chord error of an arc with this radius and
+    // sweep (radians) stays within chordTolerance.
+    static int ArcSegments(float radius, float sweep, float chordTolerance, int minSegments = 1);
+
+    // Distance from p to the circular arc sweeping counter-clockwise from
+    // startAngle; a sweep of 2pi or more is a full circle.
+    static float DistanceToArc(const glm::vec2& p, const glm::vec2& center, float radius,
+        float startAngle, float sweep);
+    // Exact box of the same arc: endpoints plus every axis extreme inside the sweep
+    static void ArcBounds(const glm::vec2& center, float radius, float startAngle, float sweep, float bounds[4]);
+
+    // Douglas-Peucker for every tolerance at once. rank[i] is the tolerance up to
+    // which vertex i of the x,y pairs survives, so simplifying with tolerance t
+    // keeps exactly the vertices ranked above t. The endpoints rank infinite.
+    static void DouglasPeuckerRanks(const std::vector<float>& xy, std::vector<float>& rank);
+
     // Given aQ check whether its in [a1, a2]
     static bool AngleOnArc(float a1, float a2, float aQ, float bulge);
 
@@ -55,14 +79,55 @@ public:
         const glm::vec2& a1, const glm::vec2& a2, float bulgeA,
         const glm::vec2& b1, const glm::vec2& b2, float bulgeB);
 
+    // Box of the segment, an arc by its sweep, grown by the tolerance of the
+    // intersection tests so segments that may meet have overlapping boxes
+    static void SegmentBounds(const PolylineSegment& seg, float bounds[4]);
+
+    // Intersections of polyline A with polyline B; segmentIndex is the segment of A
     static std::vector<IntersectionPoint> PolylineIntersections(
         const std::vector<PolylineVertex>& polyA, bool closedA,
         const std::vector<PolylineVertex>& polyB, bool closedB);
 
+    struct PolylineView {
+        const std::vector<PolylineVertex>* vertices;
+        bool closed;
+        // Padded segment boxes from SegmentBounds, e.g. a cached segment index;
+        // null to have the sweep box the segments itself
+        const float* segmentBounds = nullptr;
+    };
+
+    // Intersections of every target with all cutters at once, indexed like
+    // targets; segmentIndex is the segment of the target. Segments and
+    // x-monotone pieces of arcs of both sets, or the given segment boxes, are
+    // swept together, so only segments with overlapping boxes are intersected exactly.
+    static std::vector<std::vector<IntersectionPoint>> SweepIntersections(
+        const std::vector<PolylineView>& targets, const std::vector<PolylineView>& cutters);
+
     // Split a polyline at sorted intersection points.
     // sortedIntersections must be sorted by (segmentIndex, parameter).
     // Returns a list of sub-polyline vertex lists (all open).
     static std::vector<std::vector<PolylineVertex>> SplitPolyline(
         const std::vector<PolylineVertex>& poly, bool closed,
         const std::vector<IntersectionPoint>& sortedIntersections);
+
+    struct SplitResult {
+        std::vector<std::shared_ptr<Polyline>> polylines;  // open sub-polylines, on the layer of their source
+        std::vector<glm::vec2> intersections;
+        size_t cutterCount = 0;
+        size_t targetCount = 0;
+    };
+
+    // Splits every polyline not on cutterLayer at its intersections with the
+    // polylines on cutterLayer. Block instances take part in world coordinates.
+    // The sweep takes the segment boxes of each polyline's cached segment
+    // index, so splitting the same drawing again does not box them again.
+    static SplitResult SplitByCutterLayer(
+        const std::vector<std::shared_ptr<Entity>>& entities, const std::string& cutterLayer);
+
+    // Same split for entities already grouped by a layer index: cutterEntities
+    // are the entities on cutterLayer, otherEntities the rest. Only polylines of
+    // block instances still have their layer compared.
+    static SplitResult SplitByCutterLayer(
+        const std::vector<std::shared_ptr<Entity>>& cutterEntities,
+        const std::vector<std::shared_ptr<Entity>>& otherEntities, const std::string& cutterLayer);
 };
\ No newline at end of file
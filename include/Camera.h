@@ -16,10 +16,23 @@ public:
     void zoomAt(float factor, glm::vec2 mousePos);
     void pan(float dx, float dy);
     void reset() { _zoom = 1.0f; _offset = glm::vec2(0.0f); }
+    // Centers the world rectangle (minX, minY, maxX, maxY) and zooms so it fills
+    // the viewport, leaving margin (a fraction of the viewport) free on each side
+    void fitRect(const float rect[4], float margin);
+    // Zoom fitRect picks for a viewport of this size
+    static float FitScale(float width, float height, const float rect[4], float margin);
 
 	double getScale() const { return _zoom; }
 	glm::vec2 getOffset() const { return _offset; }
 
+    // World rectangle covered by the viewport: minX, minY, maxX, maxY
+    void getWorldRect(float rect[4]) const {
+        rect[0] = -_offset.x / _zoom;
+        rect[1] = -_offset.y / _zoom;
+        rect[2] = (_width - _offset.x) / _zoom;
+        rect[3] = (_height - _offset.y) / _zoom;
+    }
+
     glm::mat4 getMatrix() const {
         glm::mat4 view = glm::mat4(1.0f);
         view = glm::translate(view, glm::vec3(_offset, 0.0f));
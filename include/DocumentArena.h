@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+// Bump allocator for the entities of one drawing. Allocation is a pointer
+// increment and freeing an entity is a no-op; the memory goes back in a few
+// large blocks once the last entity allocated from the arena is gone.
+// Allocate from one thread at a time; entities may be released from any thread.
+class DocumentArena
+{
+public:
+    DocumentArena() : _resource(INITIAL_BLOCK_SIZE) {}
+    DocumentArena(const DocumentArena&) = delete;
+    DocumentArena& operator=(const DocumentArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment) {
+        _bytesAllocated += bytes;
+        return _resource.allocate(bytes, alignment);
+    }
+    size_t getBytesAllocated() const { return _bytesAllocated; }
+
+    // Like std::make_shared, with the object and its control block in the arena.
+    // Every object keeps the arena alive.
+    template <class T, class... Args>
+    static std::shared_ptr<T> make(const std::shared_ptr<DocumentArena>& arena, Args&&... args);
+
+private:
+    static constexpr size_t INITIAL_BLOCK_SIZE = 1 << 20;
+
+    std::pmr::monotonic_buffer_resource _resource;
+    size_t _bytesAllocated = 0;
+};
+
+// Allocator handed to std::allocate_shared; owning the arena means the
+// control block of the last entity releases it.
+template <class T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(std::shared_ptr<DocumentArena> arena) : _arena(std::move(arena)) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.arena()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    const std::shared_ptr<DocumentArena>& arena() const { return _arena; }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return _arena == other.arena(); }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return _arena != other.arena(); }
+
+private:
+    std::shared_ptr<DocumentArena> _arena;
+};
+
+template <class T, class... Args>
+std::shared_ptr<T> DocumentArena::make(const std::shared_ptr<DocumentArena>& arena, Args&&... args)
+{
+    return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
@@ -3,51 +3,115 @@
 #include <libdxfrw.h>
 #include <drw_interface.h>
 #include <iostream>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <DocumentArena.h>
+#include <LayerTable.h>
 #include <Entities/Entity.h>
+#include <Entities/Block.h>
+
+class Tessellator;
+
+// Structured statistics of one load, filled in phase by phase.
+// Counts are keyed by DXF record name (LINE, LWPOLYLINE, ...).
+struct DxfLoadReport
+{
+    std::map<std::string, size_t> entitiesByType;
+    std::map<std::string, size_t> entitiesByLayer;
+    std::map<std::string, size_t> skippedByType; // unsupported or empty records
+    size_t entityCount = 0;
+    size_t skippedCount = 0;
+    size_t vertexCount = 0;
+    bool fromCache = false; // parse time is then the cache read time
+
+    // Wall time per phase in milliseconds. Parse excludes the tessellation stage;
+    // upload and tree build are filled in by the viewer.
+    double parseMs = 0.0;
+    double tessellateMs = 0.0;
+    double uploadMs = 0.0;
+    double treeBuildMs = 0.0;
+
+    // Memory cost of the load: heap allocations made by the loading thread and
+    // the tessellation workers, bytes placed in the document arena and the
+    // process peak RSS afterwards.
+    std::uint64_t allocationCount = 0;
+    size_t arenaBytes = 0;
+    std::uint64_t peakRssBytes = 0;
+};
 
 class DxfLoader : public DRW_Interface
 {
 public:
     DxfLoader();
+    ~DxfLoader() override;
+
+    // Reports (bytesRead, totalBytes) while the file is parsed.
+    // Return false from the callback to cancel the load.
+    using ProgressCallback = std::function<bool(std::uint64_t, std::uint64_t)>;
+    // Receives parsed entities in batches while the file is still being read.
+    using ChunkCallback = std::function<void(std::vector<std::shared_ptr<Entity>>)>;
 
+    // Safe to call from a worker thread; the callback is invoked on that thread.
     bool load(const std::string& filename);
     std::vector<std::shared_ptr<Entity>> getEntities() const { return _entities; }
+    const DxfLoadReport& getReport() const { return _report; }
+    // Block definitions by name, built and ready for instanced drawing
+    const std::map<std::string, std::shared_ptr<BlockDefinition>>& getBlocks() const { return _blocks; }
+    // Layers from the LAYER table plus any layer only named by an entity.
+    // Complete before the first chunk is delivered, since the table precedes the entities.
+    const LayerTable& getLayers() const { return _layers; }
+
+    void setProgressCallback(ProgressCallback callback) { _progress = std::move(callback); }
+    // Batches hold chunkSize entities, the last one may be shorter.
+    // getEntities() still returns everything once load() has returned.
+    void setChunkCallback(ChunkCallback callback, size_t chunkSize = 4096) {
+        _chunkCallback = std::move(callback);
+        _chunkSize = chunkSize;
+    }
+    bool wasCancelled() const { return _cancelled; }
+    // Chord error allowed when curves are tessellated, in world units
+    void setChordTolerance(float tolerance) { _chordTolerance = tolerance; }
+    // Threads of the tessellation stage, 0 for one per core. Callers that
+    // already load one file per core pass 1.
+    void setTessellationThreads(unsigned threads);
 
     // --- Reading overrides ---
     void addHeader(const DRW_Header* data) override {}
     void addLType(const DRW_LType& data) override {}
-    void addLayer(const DRW_Layer& data) override {}
-    void addBlock(const DRW_Block& data) override {}
+    void addLayer(const DRW_Layer& data) override;
+    void addBlock(const DRW_Block& data) override;
     void setBlock(const int handle) override {}
-    void endBlock() override {}
-    void addPoint(const DRW_Point& data) override {}
-    void addRay(const DRW_Ray& data) override {}
+    void endBlock() override;
+    void addPoint(const DRW_Point& data) override { skipEntity("POINT"); }
+    void addRay(const DRW_Ray& data) override { skipEntity("RAY"); }
     void addLine(const DRW_Line& data) override;
-    void addXline(const DRW_Xline& data) override {}
+    void addXline(const DRW_Xline& data) override { skipEntity("XLINE"); }
     void addArc(const DRW_Arc& data) override;
     void addCircle(const DRW_Circle& data) override;
-    void addEllipse(const DRW_Ellipse& data) override {}
+    void addEllipse(const DRW_Ellipse& data) override { skipEntity("ELLIPSE"); }
     void addLWPolyline(const DRW_LWPolyline& data) override;
     void addPolyline(const DRW_Polyline& data) override;
-    void addSpline(const DRW_Spline* data) override {}
+    void addSpline(const DRW_Spline* data) override { skipEntity("SPLINE"); }
     void addKnot(const DRW_Entity& data) override {}
-    void addInsert(const DRW_Insert& data) override {}
-    void addTrace(const DRW_Trace& data) override {}
-    void add3dFace(const DRW_3Dface& data) override {}
-    void addSolid(const DRW_Solid& data) override {}
-    void addMText(const DRW_MText& data) override {}
-    void addText(const DRW_Text& data) override {}
-    void addDimAlign(const DRW_DimAligned* data) override {}
-    void addDimLinear(const DRW_DimLinear* data) override {}
-    void addDimRadial(const DRW_DimRadial* data) override {}
-    void addDimDiametric(const DRW_DimDiametric* data) override {}
-    void addDimAngular(const DRW_DimAngular* data) override {}
-    void addDimAngular3P(const DRW_DimAngular3p* data) override {}
-    void addDimOrdinate(const DRW_DimOrdinate* data) override {}
-    void addLeader(const DRW_Leader* data) override {}
-    void addHatch(const DRW_Hatch* data) override {}
-    void addViewport(const DRW_Viewport& data) override {}
-    void addImage(const DRW_Image* data) override {}
+    void addInsert(const DRW_Insert& data) override;
+    void addTrace(const DRW_Trace& data) override { skipEntity("TRACE"); }
+    void add3dFace(const DRW_3Dface& data) override { skipEntity("3DFACE"); }
+    void addSolid(const DRW_Solid& data) override { skipEntity("SOLID"); }
+    void addMText(const DRW_MText& data) override { skipEntity("MTEXT"); }
+    void addText(const DRW_Text& data) override { skipEntity("TEXT"); }
+    void addDimAlign(const DRW_DimAligned* data) override { skipEntity("DIMENSION"); }
+    void addDimLinear(const DRW_DimLinear* data) override { skipEntity("DIMENSION"); }
+    void addDimRadial(const DRW_DimRadial* data) override { skipEntity("DIMENSION"); }
+    void addDimDiametric(const DRW_DimDiametric* data) override { skipEntity("DIMENSION"); }
+    void addDimAngular(const DRW_DimAngular* data) override { skipEntity("DIMENSION"); }
+    void addDimAngular3P(const DRW_DimAngular3p* data) override { skipEntity("DIMENSION"); }
+    void addDimOrdinate(const DRW_DimOrdinate* data) override { skipEntity("DIMENSION"); }
+    void addLeader(const DRW_Leader* data) override { skipEntity("LEADER"); }
+    void addHatch(const DRW_Hatch* data) override { skipEntity("HATCH"); }
+    void addViewport(const DRW_Viewport& data) override { skipEntity("VIEWPORT"); }
+    void addImage(const DRW_Image* data) override { skipEntity("IMAGE"); }
     void linkImage(const DRW_ImageDef* data) override {}
     void addComment(const char* comment) override {}
     void addPlotSettings(const DRW_PlotSettings* data) override {}
@@ -71,5 +135,48 @@ public:
     void addAppId(const DRW_AppId& data) override {}
 
 private:
+    // Called once per entity record handed over by libdxfrw; every few records
+    // reports the reader's file offset and polls the progress callback.
+    void entityRead();
+    // Counts a record the viewer has no entity for.
+    void skipEntity(const char* type);
+    // Records a constructed entity in the report. Entities that need vertices
+    // wait for the tessellation stage.
+    void addEntity(const char* type, std::shared_ptr<Entity> entity, bool tessellate = false);
+    // Runs the tessellation stage on the waiting entities; before a chunk is
+    // published and before blocks are built
+    void tessellatePending();
+    void flushChunk();
+    // Definition for a name, created empty if an INSERT refers to it first
+    std::shared_ptr<BlockDefinition> blockNamed(const std::string& name);
+    void buildBlocks();
+    // One shared name per layer instead of a string per entity
+    std::shared_ptr<const std::string> internLayer(const std::string& name);
+
     std::vector<std::shared_ptr<Entity>> _entities;
+    DxfLoadReport _report;
+
+    // Entities of the current document; a new load starts a new arena and the
+    // old one goes away with the last entity that still uses it.
+    std::shared_ptr<DocumentArena> _arena;
+    LayerTable _layers;
+
+    std::map<std::string, std::shared_ptr<BlockDefinition>> _blocks;
+    std::shared_ptr<BlockDefinition> _currentBlock; // entities go here between addBlock and endBlock
+    bool _blocksBuilt = false;
+
+    ProgressCallback _progress;
+    ChunkCallback _chunkCallback;
+    size_t _chunkSize = 4096;
+    float _chordTolerance;          // set from AutoDxfHelper::DEFAULT_CHORD_TOLERANCE
+    unsigned _tessellationThreads = 0;
+    std::unique_ptr<Tessellator> _tessellator; // made by the first stage that runs, kept across loads
+    std::vector<std::shared_ptr<Entity>> _pending; // parsed, not yet tessellated
+    std::vector<std::shared_ptr<Entity>> _chunk;
+    std::uint64_t _fileSize = 0;
+    std::uint64_t _fileId[2] = {};  // device and inode, or volume and file index
+    bool _fileKnown = false;        // false stops looking for the reader's descriptor
+    int _readerFd = -1;             // descriptor libdxfrw reads through, found on the first report
+    size_t _entitiesRead = 0;
+    bool _cancelled = false;
 };
\ No newline at end of file
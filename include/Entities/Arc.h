@@ -1,12 +1,32 @@
 #pragma once
 
 #include <vector>
-#include <QOpenGLFunctions_3_3_Core>
 #include "Entities/Entity.h"
 
 class Arc : public Entity
 {
 public:
     Arc(float cx, float cy, float radius, float startAngle, float endAngle, int segments = 64);
-    void draw(QOpenGLFunctions_3_3_Core* f) const override;
-};
\ No newline at end of file
+    // Skips tessellation, the vertices were computed before (scene cache)
+    Arc(float cx, float cy, float radius, float startAngle, float endAngle, std::vector<float> tessellated);
+
+    bool tessellate(float chordTolerance, std::vector<float>& out) const override;
+    // Exact, so they also work when the vertices were never computed
+    bool hitTest(float worldX, float worldY, float tolerance) const override;
+    bool getBounds(float bounds[4]) const override;
+    bool getCircularArc(float& cx, float& cy, float& radius, float& startAngle, float& sweep) const override;
+
+    float getCenterX() const { return _cx; }
+    float getCenterY() const { return _cy; }
+    float getRadius() const { return _radius; }
+    float getStartAngle() const { return _startAngle; }
+    // Counter-clockwise sweep from the start angle, in (0, 2pi]
+    float getAngleRange() const { return _angleRange; }
+
+private:
+    static std::vector<float> Tessellate(float cx, float cy, float radius,
+        float startAngle, float angleRange, int segments);
+
+    float _cx = 0.0f, _cy = 0.0f, _radius = 0.0f;
+    float _startAngle = 0.0f, _angleRange = 0.0f;
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <QOpenGLFunctions_3_3_Core>
 #include "Entities/Entity.h"
 
 class Axis : public Entity {
@@ -6,10 +7,15 @@ public:
     enum Type { X, Y };
     Axis(Type type, float length = 1000.0f, float arrowSize = 10.0f);
 
-    void createBuffers(QOpenGLFunctions_3_3_Core* f) override;
-    void draw(QOpenGLFunctions_3_3_Core* f) const override;
+    // The axes are part of the view, not the drawing, so they keep their own buffers
+    void createBuffers(QOpenGLFunctions_3_3_Core* f);
+    void deleteBuffers(QOpenGLFunctions_3_3_Core* f);
+    void draw(QOpenGLFunctions_3_3_Core* f) const;
+    DrawMode getDrawMode() const override { return DrawMode::Lines; }
 
 private:
+    GLuint _vAO = 0;
+    GLuint _vBO = 0;
     Type _type;
     float _length;
     float _arrowSize;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Entities/Entity.h"
+
+// A BLOCK definition: entities in block coordinates, shared by every INSERT.
+// Its geometry is tessellated once into a single vertex array with one draw
+// range per entity, so all references can be drawn instanced.
+class BlockDefinition
+{
+public:
+    struct DrawRange {
+        std::int32_t first;      // in vertices
+        std::int32_t count;
+        Entity::DrawMode mode;
+        float color[3];
+    };
+
+    explicit BlockDefinition(const std::string& name) : _name(name) {}
+
+    const std::string& getName() const { return _name; }
+    const glm::vec2& getBasePoint() const { return _basePoint; }
+    void setBasePoint(const glm::vec2& basePoint) { _basePoint = basePoint; }
+
+    // May contain nested Inserts
+    const std::vector<std::shared_ptr<Entity>>& getEntities() const { return _entities; }
+    void addEntity(std::shared_ptr<Entity> entity) { _entities.push_back(std::move(entity)); }
+
+    // Flattens the entities, nested inserts expanded, into the vertex array,
+    // relative to the base point. Must run once after the whole file is read,
+    // before rendering or picking, since blocks may be referenced before they are defined.
+    void build();
+    bool isBuilt() const { return _built; }
+    // Drops the flattened geometry so the next build() picks up entities that
+    // were re-tessellated. Blocks nesting this one must be rebuilt too.
+    void invalidate();
+
+    const std::vector<float>& getVertices() const { return _vertices; }
+    const std::vector<DrawRange>& getRanges() const { return _ranges; }
+    // minX, minY, maxX, maxY of the built vertices; inverted if there are none
+    const float* getBounds() const { return _bounds; }
+
+private:
+    std::string _name;
+    glm::vec2 _basePoint{ 0.0f };
+    std::vector<std::shared_ptr<Entity>> _entities;
+
+    bool _built = false;
+    bool _building = false; // guards against self-referencing blocks
+    std::vector<float> _vertices;
+    std::vector<DrawRange> _ranges;
+    float _bounds[4] = { 0.0f, 0.0f, -1.0f, -1.0f };
+};
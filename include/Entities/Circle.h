@@ -1,14 +1,30 @@
 #pragma once
 
 #include <vector>
-#include <QOpenGLFunctions_3_3_Core>
 #include "Entities/Entity.h"
 
 class Circle : public Entity
 {
 public:
     Circle(float cx, float cy, float radius, int segments = 64);
+    // Skips tessellation, the vertices were computed before (scene cache)
+    Circle(float cx, float cy, float radius, std::vector<float> tessellated);
 
-    void draw(QOpenGLFunctions_3_3_Core* f) const;
     std::string getType() const override { return "Circle"; }
+    DrawMode getDrawMode() const override { return DrawMode::LineLoop; }
+
+    bool tessellate(float chordTolerance, std::vector<float>& out) const override;
+    // Exact, so they also work when the vertices were never computed
+    bool hitTest(float worldX, float worldY, float tolerance) const override;
+    bool getBounds(float bounds[4]) const override;
+    bool getCircularArc(float& cx, float& cy, float& radius, float& startAngle, float& sweep) const override;
+
+    float getCenterX() const { return _cx; }
+    float getCenterY() const { return _cy; }
+    float getRadius() const { return _radius; }
+
+private:
+    static std::vector<float> Tessellate(float cx, float cy, float radius, int segments);
+
+    float _cx = 0.0f, _cy = 0.0f, _radius = 0.0f;
 };
@@ -1,7 +1,8 @@
 #pragma once
 
+#include <memory>
 #include <string>
-#include <QOpenGLFunctions_3_3_Core>
+#include <vector>
 
 class Entity
 {
@@ -9,13 +10,13 @@ public:
     Entity();
     virtual ~Entity() = default;
 
-    // Draw with the given OpenGL function resolver.
-    // Derived classes must implement this.
-    virtual void draw(QOpenGLFunctions_3_3_Core* f) const = 0;
-
     // Optional type identification
     virtual std::string getType() const { return "Entity"; }
 
+    // How the tessellated vertices connect; the renderer maps this to a GL primitive
+    enum class DrawMode { Lines, LineStrip, LineLoop };
+    virtual DrawMode getDrawMode() const { return DrawMode::LineStrip; }
+
     // Color getters/setters
     const float* getColor() const { return _color; }
     float getAlpha() const { return _alpha; }
@@ -28,24 +29,61 @@ public:
 		_alpha = alpha;
 	}
 
-    const std::string& getLayer() const { return _layer; }
-    void setLayer(const std::string& layer) { _layer = layer; }
+    // Number of tessellated vertices
+    size_t getVertexCount() const { return vertices.size() / 2; }
+    // Tessellated vertices as x,y pairs
+    const std::vector<float>& getVertices() const { return vertices; }
+    // Adopt already tessellated vertices, e.g. from the scene cache
+    void setVertices(std::vector<float> verts) { vertices = std::move(verts); onVerticesChanged(); }
+
+    // Simplified copy of the vertices for drawing zoomed out: no dropped vertex
+    // lies farther than tolerance (world units) from the kept outline
+    struct LodLevel {
+        float tolerance;
+        std::vector<float> vertices;
+    };
+    // Coarsest first; empty when the entity is always drawn in full
+    virtual const std::vector<LodLevel>& getLodLevels() const;
+    // LOD levels this entity would keep for the given vertices. Reads nothing
+    // of the entity, so a worker thread can prepare them for setVertices.
+    virtual std::vector<LodLevel> makeLodLevels(const std::vector<float>& verts) const { return {}; }
+    // setVertices with LOD levels made for them beforehand by makeLodLevels
+    void setVertices(std::vector<float> verts, std::vector<LodLevel> lodLevels) {
+        vertices = std::move(verts);
+        adoptLodLevels(std::move(lodLevels));
+    }
+
+    const std::string& getLayer() const;
+    void setLayer(const std::string& layer) { _layer = std::make_shared<const std::string>(layer); }
+    // Shares one interned name between all entities of a layer
+    void setLayer(std::shared_ptr<const std::string> layer) { _layer = std::move(layer); }
 
-    // Buffer setup/teardown
-    virtual void createBuffers(QOpenGLFunctions_3_3_Core* f);
-    virtual void deleteBuffers(QOpenGLFunctions_3_3_Core* f);
+    // Recompute the vertices of curved geometry so the chord error stays within
+    // chordTolerance (world units). Returns false if the entity has no curves.
+    // Only reads construction data, so it may run on a worker thread.
+    virtual bool tessellate(float chordTolerance, std::vector<float>& out) const { return false; }
 
 	// Hit test: check if (worldX, worldY) is within 'tolerance' of the entity.
     virtual bool hitTest(float worldX, float worldY, float tolerance) const;
 
+    // World-space box as minX, minY, maxX, maxY; false if there is no geometry
+    virtual bool getBounds(float bounds[4]) const;
+    // Box of x,y pairs; false if there are none
+    static bool BoundsOf(const std::vector<float>& verts, float bounds[4]);
+
+    // Circles and arcs describe themselves analytically, so a renderer can draw
+    // them exactly without tessellated vertices. Sweep is counter-clockwise, 2pi for a circle.
+    virtual bool getCircularArc(float& cx, float& cy, float& radius, float& startAngle, float& sweep) const { return false; }
+
 protected:
+    // Called after setVertices so derived data can follow
+    virtual void onVerticesChanged() {}
+    // Called by setVertices with levels from makeLodLevels instead
+    virtual void adoptLodLevels(std::vector<LodLevel> lodLevels) {}
+
     float _color[3] = { 1.0f, 1.0f, 1.0f };   // Default: white
 	float _alpha = 1.0f; // Default: fully opaque
-    std::string _layer;
-
-    // OpenGL handles for a simple VAO + VBO
-    GLuint _vAO = 0;
-    GLuint _vBO = 0;
+    std::shared_ptr<const std::string> _layer;
 
     // vertices for OpenGL to display
     std::vector<float> vertices;
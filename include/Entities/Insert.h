@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Entities/Entity.h"
+#include "Entities/Block.h"
+#include "Entities/Polyline.h"
+
+// One placed instance of a block. An INSERT with rows/columns yields one
+// Insert per array cell, so picking and splitting see each copy.
+// The geometry lives in the BlockDefinition and is drawn instanced by Render2D.
+class Insert : public Entity
+{
+public:
+    Insert(std::shared_ptr<BlockDefinition> block, const glm::mat3& transform);
+
+    // Base-point relative block coordinates to world for an INSERT array cell
+    static glm::mat3 MakeTransform(const glm::vec2& insertionPoint,
+        float xScale, float yScale, float rotation, const glm::vec2& cellOffset);
+
+    std::string getType() const override { return "Insert"; }
+    bool hitTest(float worldX, float worldY, float tolerance) const override;
+    bool getBounds(float bounds[4]) const override;
+
+    const std::shared_ptr<BlockDefinition>& getBlock() const { return _block; }
+    const glm::mat3& getTransform() const { return _transform; }
+
+    // Polylines of the block in world coordinates, nested inserts expanded.
+    // Entities on layer "0" take the layer of the insert.
+    std::vector<std::shared_ptr<Polyline>> getWorldPolylines() const;
+
+private:
+    std::shared_ptr<BlockDefinition> _block;
+    glm::mat3 _transform;
+    glm::mat3 _inverse;
+};
@@ -2,15 +2,14 @@
 
 #include "Entities/Entity.h"
 #include <vector>
-#include <QOpenGLFunctions_3_3_Core>
 
 class Line : public Entity
 {
 public:
+    Line() = default;
     // Construct with two endpoints
     Line(float x1, float y1, float x2, float y2);
 
-    // Draw with the given OpenGL functions resolver
-    void draw(QOpenGLFunctions_3_3_Core* f) const override;
     std::string getType() const override { return "Polyline"; }
+    DrawMode getDrawMode() const override { return DrawMode::Lines; }
 };
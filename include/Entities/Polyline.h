@@ -1,9 +1,12 @@
 #pragma once
 
 #include "Entities/Entity.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <glm/vec2.hpp>
-#include "DxfLoader.h"
+#include "Dxfloader.h"
+#include "RTree.h"
 
 struct PolylineVertex {
     glm::vec2 position;
@@ -17,17 +20,67 @@ class Polyline : public Entity {
 public:
     Polyline() = default;
     explicit Polyline(const DRW_LWPolyline& plydata);
+    Polyline(const DRW_LWPolyline& plydata, float chordTolerance);
     Polyline(const std::vector<PolylineVertex>& verts, bool closed);
-
-    // Implement pure virtual function from Entity
-    void draw(QOpenGLFunctions_3_3_Core* f) const override;
+    Polyline(const std::vector<PolylineVertex>& verts, bool closed, float chordTolerance);
+    // Skips tessellation: the vertices were computed before (scene cache) or
+    // are left to a tessellation stage (Tessellator)
+    Polyline(std::vector<PolylineVertex> verts, bool closed, std::vector<float> tessellated);
 
     std::string getType() const override { return "Polyline"; }
+    DrawMode getDrawMode() const override { return isClosed ? DrawMode::LineLoop : DrawMode::LineStrip; }
 
     const std::vector<PolylineVertex>& getPolyVertices() const { return m_plyvertices; }
     bool getIsClosed() const { return isClosed; }
 
+    bool tessellate(float chordTolerance, std::vector<float>& out) const override;
+
+    // Boxes of the bulge segments (segment i starts at vertex i) from
+    // AutoDxfHelper::SegmentBounds, which takes arcs by their sweep and pads each
+    // box by the tolerance of the intersection tests, with an R-tree over them.
+    // Built on first use; the bulge vertices are fixed once constructed, so it
+    // stays valid, and retessellating does not touch it. Picking searches the
+    // tree, the split sweeps the boxes.
+    struct SegmentIndex {
+        std::vector<float> bounds;
+        RTree tree;
+    };
+    std::shared_ptr<const SegmentIndex> getSegmentIndex() const;
+    size_t getSegmentCount() const;
+
+    // Exact distance from the point to the nearest segment, or -1 if none is
+    // within maxDistance
+    float distanceTo(float x, float y, float maxDistance) const;
+
+    // Douglas-Peucker pyramid of the tessellated vertices, rebuilt with them
+    const std::vector<LodLevel>& getLodLevels() const override { return m_lodLevels; }
+    std::vector<LodLevel> makeLodLevels(const std::vector<float>& verts) const override;
+    // Shorter outlines are always drawn in full
+    static constexpr size_t kMinLodVertices = 64;
+
+    // Vertices of the polyline with bulge arcs expanded within chordTolerance
+    static std::vector<float> Tessellate(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance);
+    // The same in pieces, so one long polyline can be split between threads:
+    // counts[i - begin] is the number of vertices source vertex i expands to
+    // (itself and the inner points of its bulge arc), and TessellateRange
+    // writes those of source vertices [begin, end) from out on.
+    static void CountTessellated(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance,
+        size_t begin, size_t end, std::uint32_t* counts);
+    static void TessellateRange(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance,
+        size_t begin, size_t end, float* out);
+
+    // Bulge vertices of an LWPOLYLINE record
+    static std::vector<PolylineVertex> VerticesOf(const DRW_LWPolyline& plydata);
+
+protected:
+    void onVerticesChanged() override { m_lodLevels = makeLodLevels(vertices); }
+    void adoptLodLevels(std::vector<LodLevel> lodLevels) override { m_lodLevels = std::move(lodLevels); }
+
 private:
     std::vector<PolylineVertex> m_plyvertices;
     bool isClosed = false;
+    std::vector<LodLevel> m_lodLevels;
+    // Shared by copies, which have the same vertices; swapped atomically so
+    // concurrent first uses at worst build it twice
+    mutable std::shared_ptr<const SegmentIndex> m_segmentIndex;
 };
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Rolling window of per-frame renderer timings and counters. CPU time is split
+// by phase; GPU time arrives a few frames late from timer queries and is kept
+// in its own window. Summaries are computed on demand, for an on-screen
+// overlay or a benchmark.
+class FrameStats
+{
+public:
+    enum Phase { Upload, Cull, Batch, Submit, PhaseCount };
+
+    static constexpr size_t kWindow = 240;
+    // A longer gap between frames is idle time, not a slow frame
+    static constexpr double kIdleGapMs = 500.0;
+
+    struct Summary {
+        size_t frames = 0;
+        double fps = 0.0;
+        double frameP50Ms = 0.0;            // start of one frame to the next
+        double frameP99Ms = 0.0;
+        double cpuMs[PhaseCount] = {};      // mean per frame
+        double cpuTotalMs = 0.0;
+        double gpuP50Ms = -1.0;             // -1 without timer query results
+        double gpuP99Ms = -1.0;
+        double drawCalls = 0.0;             // mean per frame
+        double vertices = 0.0;
+    };
+
+    void beginFrame();
+    void endFrame();
+    void addCpuTime(Phase phase, double ms) { _current.cpuMs[phase] += ms; }
+    void countDraw(std::uint64_t vertices) { ++_current.drawCalls; _current.vertices += vertices; }
+    void addGpuTime(double ms);
+    void clear();
+
+    Summary summarize() const;
+
+    // Adds the time until it goes out of scope to a phase
+    class Timer
+    {
+    public:
+        Timer(FrameStats& stats, Phase phase)
+            : _stats(stats), _phase(phase), _start(std::chrono::steady_clock::now()) {}
+        ~Timer() { _stats.addCpuTime(_phase, ElapsedMs(_start)); }
+    private:
+        FrameStats& _stats;
+        Phase _phase;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    static double ElapsedMs(std::chrono::steady_clock::time_point since);
+
+private:
+    struct Sample {
+        double intervalMs = 0.0;            // 0 for the first frame after an idle gap
+        double cpuMs[PhaseCount] = {};
+        std::uint32_t drawCalls = 0;
+        std::uint64_t vertices = 0;
+    };
+
+    Sample _current;
+    std::chrono::steady_clock::time_point _frameStart;
+    bool _hasPreviousFrame = false;
+    std::vector<Sample> _samples;           // ring of kWindow
+    size_t _nextSample = 0;
+    std::vector<double> _gpuMs;             // ring of kWindow
+    size_t _nextGpu = 0;
+};
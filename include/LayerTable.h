@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// State of one DXF layer as read from the LAYER table
+struct LayerInfo
+{
+    std::string name;
+    float color[3] = { 1.0f, 1.0f, 1.0f };
+    bool visible = true;    // DXF "off" is a negative color number
+    bool frozen = false;
+
+    bool isDrawn() const { return visible && !frozen; }
+};
+
+// Interned layers: every name maps to a small stable id, and entities share
+// one name string per layer.
+class LayerTable
+{
+public:
+    using LayerId = std::uint32_t;
+    static constexpr LayerId INVALID_ID = ~LayerId(0);
+
+    // Id of the layer, added with default state if it is not known yet
+    LayerId intern(const std::string& name);
+    LayerId find(const std::string& name) const;
+
+    size_t size() const { return _layers.size(); }
+    LayerInfo& get(LayerId id) { return _layers[id]; }
+    const LayerInfo& get(LayerId id) const { return _layers[id]; }
+    const std::shared_ptr<const std::string>& getSharedName(LayerId id) const { return _names[id]; }
+
+    // Copies color and visibility of layers with the same name in other
+    void mergeState(const LayerTable& other);
+    void clear();
+
+    // RGB of an AutoCAD color index; indices beyond the named colors map to gray
+    static void AciToRgb(int aci, float rgb[3]);
+
+private:
+    std::vector<LayerInfo> _layers;
+    std::vector<std::shared_ptr<const std::string>> _names;
+    std::unordered_map<std::string, LayerId> _index;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Process memory figures for load reports.
+namespace MemoryStats
+{
+    // Heap allocations (operator new) made by the calling thread so far
+    std::uint64_t threadAllocationCount();
+    // Peak resident set size of the process in bytes, 0 if unknown
+    std::uint64_t peakResidentBytes();
+}
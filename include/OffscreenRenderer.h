@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <QColor>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include "Entities/Entity.h"
+#include "LayerTable.h"
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class QOpenGLFramebufferObject;
+class Render2D;
+
+// Renders entities to an image without a window: an OpenGL 3.3 core context on
+// an offscreen surface, drawing into a framebuffer object with the camera fitted
+// to the drawing. The context and the Render2D are kept and reused image after
+// image. Create it on the GUI thread and render from the thread that called init().
+class OffscreenRenderer
+{
+public:
+    OffscreenRenderer();
+    ~OffscreenRenderer();
+
+    // Creates the context; false with a reason if OpenGL 3.3 core is unavailable
+    bool init(QString* error = nullptr);
+
+    // The entities zoomed to extents in an image of the given size; margin is a
+    // fraction of the size left free on each side. Null image on failure.
+    QImage render(const std::vector<std::shared_ptr<Entity>>& entities, const LayerTable& layers,
+        const QSize& size, const QColor& background, float margin = DEFAULT_MARGIN);
+
+    // Re-tessellates curves for the zoom render() will fit them at, so arcs are
+    // smooth in the image, and rebuilds the blocks the inserts reference with
+    // their members re-tessellated the same way. Touches no GL state, so loader
+    // threads can run it.
+    static void tessellateFor(const std::vector<std::shared_ptr<Entity>>& entities,
+        const QSize& size, float margin = DEFAULT_MARGIN);
+
+    static constexpr float DEFAULT_MARGIN = 0.05f;
+
+private:
+    std::unique_ptr<QOffscreenSurface> _surface;
+    std::unique_ptr<QOpenGLContext> _context;
+    std::unique_ptr<QOpenGLFramebufferObject> _fbo;
+    std::unique_ptr<Render2D> _renderer;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Packed R-tree over the bounding boxes of a scene, bulk-loaded with
+// Sort-Tile-Recursive: boxes are sorted into vertical slices by center x,
+// each slice by center y, and cut into full nodes; every level above is
+// packed the same way from the one below. Queries visit O(log n) nodes
+// plus the ones they report.
+// Boxes appended after a build wait in a tail that is scanned linearly;
+// update() repacks once the tail outgrows a fraction of the tree.
+class RTree
+{
+public:
+    static constexpr std::uint32_t INVALID_ID = ~std::uint32_t(0);
+
+    // bounds holds minX, minY, maxX, maxY per id; boxes with min > max are left out.
+    // The vector is referenced, not copied, and must outlive the tree.
+    void build(const std::vector<float>& bounds);
+    // Takes in the boxes appended to the bounds since the last build or update
+    void update();
+    void clear();
+
+    // Number of ids covered, indexed or in the tail
+    size_t size() const { return _count; }
+
+    // Appends every id whose box overlaps the rectangle
+    void query(float minX, float minY, float maxX, float maxY, std::vector<std::uint32_t>& out) const;
+    // Appends every id whose box lies entirely inside the rectangle
+    void queryContained(float minX, float minY, float maxX, float maxY, std::vector<std::uint32_t>& out) const;
+
+    // Id with the smallest distance(id) not above maxDistance, visiting boxes
+    // nearest first and stopping at the first box farther than the best hit.
+    // distance returns the exact distance to the id's geometry, or a negative
+    // value to skip it. Ties go to the higher id.
+    template <typename DistanceFn>
+    std::uint32_t nearest(float x, float y, float maxDistance, DistanceFn&& distance) const;
+
+private:
+    struct Node {
+        float box[4];
+        std::uint32_t first;    // into _items on the leaf level, else into _nodes
+        std::uint32_t count;
+    };
+
+    template <typename Visit>
+    void search(float minX, float minY, float maxX, float maxY, Visit&& visit) const;
+    template <typename Visit>
+    void searchNodes(float minX, float minY, float maxX, float maxY, Visit&& visit) const;
+    static float BoxDistance(const float* b, float x, float y);
+
+    const std::vector<float>* _bounds = nullptr;
+    size_t _count = 0;                      // ids seen in the bounds so far
+    std::vector<std::uint32_t> _items;      // indexed ids in leaf order
+    std::vector<Node> _nodes;               // level by level, leaves first
+    std::vector<std::uint32_t> _levelStart; // first node of each level, plus the end
+    std::vector<std::uint32_t> _tail;       // appended since the last build
+};
+
+template <typename DistanceFn>
+std::uint32_t RTree::nearest(float x, float y, float maxDistance, DistanceFn&& distance) const
+{
+    std::uint32_t best = INVALID_ID;
+    float bestDistance = maxDistance;
+    auto consider = [&](std::uint32_t id) {
+        const float* b = &(*_bounds)[id * 4];
+        if (BoxDistance(b, x, y) > bestDistance) return;
+        float d = distance(id);
+        if (d < 0.0f || d > bestDistance) return;
+        if (d < bestDistance || best == INVALID_ID || id > best) {
+            bestDistance = d;
+            best = id;
+        }
+    };
+
+    for (std::uint32_t id : _tail)
+        consider(id);
+    if (_nodes.empty()) return best;
+
+    // Best-first over nodes by the distance to their boxes
+    using Entry = std::pair<float, std::uint32_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    const std::uint32_t leafEnd = _levelStart[1];
+    for (std::uint32_t n = _levelStart[_levelStart.size() - 2]; n < _nodes.size(); ++n)
+        open.push({ BoxDistance(_nodes[n].box, x, y), n });
+
+    while (!open.empty()) {
+        auto [nodeDistance, n] = open.top();
+        open.pop();
+        if (nodeDistance > bestDistance) break;
+        const Node& node = _nodes[n];
+        if (n < leafEnd) {
+            for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+                consider(_items[i]);
+        }
+        else {
+            for (std::uint32_t c = node.first; c < node.first + node.count; ++c) {
+                float d = BoxDistance(_nodes[c].box, x, y);
+                if (d <= bestDistance) open.push({ d, c });
+            }
+        }
+    }
+    return best;
+}
@@ -3,6 +3,8 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <map>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,6 +15,11 @@
 #include "Entities/Entity.h"
 #include "Camera.h"
 #include "Entities/Axis.h"
+#include "Entities/Insert.h"
+#include "FrameStats.h"
+#include "SceneStore.h"
+#include "RTree.h"
+#include "TileGrid.h"
 
 class Render2D
 {
@@ -20,9 +27,26 @@ public:
     Render2D(int width, int height);
     ~Render2D();
 
+    // Copies the entity into the scene store; GPU upload happens on the next render.
     void addEntity(std::shared_ptr<Entity> entity);
+    // Picks up new vertices and LOD levels of an added entity after Entity::setVertices
+    void updateEntity(const Entity* entity);
+    // Re-uploads the geometry of these blocks and takes the boxes of their
+    // inserts again after BlockDefinition::build() ran on re-tessellated members
+    void updateBlockGeometry(const std::vector<BlockDefinition*>& blocks);
     const std::vector<std::shared_ptr<Entity>>& getEntities() const { return _entities; }
 
+    // Layer state as read from the file; applies to entities already added and to later ones
+    void setLayers(const LayerTable& layers);
+    const LayerTable& getLayers() const { return _store.getLayers(); }
+    // Hidden layers are skipped whole when drawing and picking
+    void setLayerVisible(const std::string& name, bool visible);
+    // Shows only the named layer, or every layer again for an empty name
+    void isolateLayer(const std::string& name);
+    // Entities on the layer from the layer index, and optionally those on every other layer
+    std::vector<std::shared_ptr<Entity>> getLayerEntities(const std::string& name,
+        std::vector<std::shared_ptr<Entity>>* otherLayers = nullptr) const;
+
     // All methods that call OpenGL take a QOpenGLFunctions_3_3_Core*,
     // which must be obtained from the current context.
     void initGL(QOpenGLFunctions_3_3_Core* f);
@@ -31,7 +55,14 @@ public:
     void resize(int width, int height, QOpenGLFunctions_3_3_Core* f);
 
     void clearEntities(QOpenGLFunctions_3_3_Core* f);
+    // Selects only this entity and dims the rest; nullptr clears the selection
     void hightlightEntity(Entity* selectedEntity);
+    // Adds an entity to or removes it from the selection
+    void setEntitySelected(Entity* entity, bool selected);
+    bool isEntitySelected(Entity* entity) const;
+    void clearSelection();
+    // Lightens the entity under the cursor; nullptr for none
+    void setHoveredEntity(Entity* entity);
 
     void handlePan(float dx, float dy);
     void handleZoom(float delta, double mouseX, double mouseY);
@@ -40,9 +71,63 @@ public:
 	glm::vec2 getMouseWorldPos(const QPoint&);
 
 	// Find the Entity that is closest to the given Point in world coordinates, within the specified tolerance.
-    Entity* findEntityAtPoint(float worldX, float worldY, float tolerance) const;
+    // Looked up in the R-tree, so the cost grows with log n rather than n.
+    Entity* findEntityAtPoint(float worldX, float worldY, float tolerance);
+    // Window selection: entities entirely inside the world rectangle. Crossing
+    // selection: entities with any part inside it. Hidden layers are skipped.
+    std::vector<Entity*> findEntitiesInRect(float minX, float minY, float maxX, float maxY, bool crossing);
+    // Indices into getEntities() of every entity whose box overlaps the world
+    // rectangle, hidden layers included, in ascending order
+    void queryEntityIds(float minX, float minY, float maxX, float maxY, std::vector<SceneStore::EntityId>& ids);
+    // Entity drawn nearest to the widget position within radius pixels, read back
+    // from an id buffer. The buffer is redrawn only after the view or scene changed,
+    // so the cost does not grow with the entity count.
+    Entity* pickEntity(QOpenGLFunctions_3_3_Core* f, const QPoint& pos, int radius);
 
 	double getCameraScale() const { return _camera.getScale(); }
+    void getViewRect(float rect[4]) const { _camera.getWorldRect(rect); }
+    // World box of every entity in the scene; false for an empty scene
+    bool getSceneBounds(float bounds[4]) const;
+    // Fits the camera to the scene bounds, leaving margin (a fraction of the viewport) on each side
+    bool zoomToExtents(float margin = 0.05f);
+    // The axes at the origin are a viewer aid; thumbnails leave them out
+    void setAxesVisible(bool visible) { _axesVisible = visible; }
+
+    // Point markers such as the intersections of a split. They are no entities:
+    // one instance buffer holds position and color of each, drawn over the
+    // scene in a single instanced call at MARKER_SIZE_PX regardless of zoom.
+    void addMarkers(const std::vector<glm::vec2>& points, const float color[3]);
+    void setMarkerColor(size_t index, const float color[3]);
+    void clearMarkers();
+    size_t getMarkerCount() const { return _markers.size(); }
+    glm::vec2 getMarkerPosition(size_t index) const { return { _markers[index].x, _markers[index].y }; }
+    // Marker nearest the world point whose disc lies within radius pixels; NO_MARKER if none
+    static constexpr size_t NO_MARKER = ~size_t(0);
+    size_t findMarkerAt(float worldX, float worldY, float radius);
+    static constexpr float MARKER_SIZE_PX = 9.0f;   // diameter
+
+    // CPU time per phase, GPU time, draw calls and vertices of recent frames
+    const FrameStats& getFrameStats() const { return _frameStats; }
+    void resetFrameStats() { _frameStats.clear(); }
+    // Bytes allocated for entity vertices, styles, states, curves and block instances
+    size_t getGpuBufferBytes() const;
+    // Bytes of the offscreen scene cache and pick targets
+    size_t getGpuTargetBytes() const;
+
+	// Curves are tessellated per zoom octave: level n covers scales up to 2^n,
+	// so the chord error stays under CHORD_TOLERANCE_PX pixels on screen.
+	static constexpr float CHORD_TOLERANCE_PX = 0.25f;
+	static constexpr int MIN_LOD_LEVEL = -10;
+	static constexpr int MAX_LOD_LEVEL = 16;
+	int getLodLevel() const;
+	static int getLodLevelForScale(double scale);
+	static float getChordTolerance(int lodLevel);
+	// Circles and arcs are drawn from their parameters and never need tessellating
+	static bool drawsAnalytically(const Entity& entity);
+	// Largest scale each block is drawn at through the inserts among entities,
+	// nested inserts included. Block members are flattened into the block, so
+	// they need the chord tolerance divided by this scale.
+	static std::unordered_map<BlockDefinition*, float> getBlockScales(const std::vector<std::shared_ptr<Entity>>& entities);
 
 private:
     GLuint compileShader(QOpenGLFunctions_3_3_Core* f, GLenum type, const char* source);
@@ -52,12 +137,202 @@ private:
 
     std::unique_ptr<Axis> _xAxis, _yAxis;
 
+    static GLenum glMode(Entity::DrawMode mode);
+
+    // Brings the scene buffers and draw lists up to date with the store
+    void syncSceneBuffer(QOpenGLFunctions_3_3_Core* f);
+    // The frame render() times
+    void renderFrame(QOpenGLFunctions_3_3_Core* f);
+    // Reads finished timer queries and starts one for this frame if a query is free
+    bool beginGpuTimer(QOpenGLFunctions_3_3_Core* f);
+
+    // All Inserts of one block on one layer. The block geometry is uploaded once
+    // and every draw range is drawn with one instanced call over all its inserts.
+    struct BlockBatch {
+        std::shared_ptr<BlockDefinition> block;
+        LayerTable::LayerId layer = 0;
+        std::vector<SceneStore::EntityId> instances;
+        GLuint vao = 0;
+        GLuint geometryVbo = 0;
+        GLuint instanceVbo = 0;     // InstanceData per insert
+        bool instancesDirty = true;
+        bool geometryDirty = false; // block rebuilt since the geometry went up
+        std::vector<SceneStore::EntityId> visible;  // inserts in view this frame, when culled
+    };
+    struct InstanceData {
+        float row0[3], row1[3];     // affine rows of the insert transform
+        SceneStore::EntityId id;
+    };
+    void uploadBlockBatch(QOpenGLFunctions_3_3_Core* f, BlockBatch& batch);
+    InstanceData instanceOf(SceneStore::EntityId id) const;
+
+    // Lines and polylines with the bound program; returns whether the tile grid culled them
+    bool drawSceneLines(QOpenGLFunctions_3_3_Core* f);
+    // Circles and arcs as instanced quads; culled uses the tile grid result of this frame.
+    // With pick set, entity ids are written instead of colors.
+    void renderCurves(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj, bool culled, bool pick = false);
+    // Points the curve VAO's instance attributes at buffer, starting at firstInstance
+    void setCurveInstances(QOpenGLFunctions_3_3_Core* f, GLuint buffer, size_t firstInstance);
+    // Inserts, one instanced draw per batch and block range; culled draws only the
+    // inserts the tile grid found for the line pass
+    void renderBlocks(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj, bool culled, bool pick = false);
+    void updatePickBuffer(QOpenGLFunctions_3_3_Core* f);
+    // Brings the R-tree up to date with the store before a query
+    void syncSpatialIndex();
+
+    // Points the block VAO's instance attributes at buffer, starting at firstInstance
+    void setBlockInstances(QOpenGLFunctions_3_3_Core* f, GLuint buffer, size_t firstInstance);
+    // Which state bits the scene programs apply; 0 while drawing the cached scene
+    void setStateMask(QOpenGLFunctions_3_3_Core* f, GLuint mask);
+    // Lines, curves and blocks without selection state into the scene cache texture
+    void renderSceneCache(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj);
+    // Selected and hovered entities, drawn again over the composited cache
+    void renderOverlay(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj);
+    void renderMarkers(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj);
+
+    // Alpha of the cached scene while anything is selected
+    static constexpr float DIMMED_ALPHA = 0.2f;
+    float dimAlpha() const { return _dimAll || !_store.getSelection().empty() ? DIMMED_ALPHA : 1.0f; }
+
 private:
     int _width;
     int _height;
-    GLuint _shaderProgram;
+    bool _axesVisible = true;
+    GLuint _shaderProgram;          // uniform color, for the axes
+    GLuint _sceneProgram = 0;       // per-entity style from a buffer texture
+    GLuint _curveProgram = 0;
+    GLuint _instanceProgram = 0;
+    GLuint _pickSceneProgram = 0;   // the same three, writing entity ids
+    GLuint _pickCurveProgram = 0;
+    GLuint _pickInstanceProgram = 0;
+    GLuint _compositeProgram = 0;   // draws the cached scene texture
+    GLuint _markerProgram = 0;
+    struct {
+        GLint projection = -1, color = -1, alpha = -1;
+        GLint sceneProjection = -1;
+        GLint curveProjection = -1, curvePixelSize = -1;
+        GLint instanceProjection = -1, instanceColor = -1;
+        GLint sceneStateMask = -1, curveStateMask = -1, instanceStateMask = -1;
+        GLint compositeAlpha = -1;
+        GLint pickSceneProjection = -1, pickCurveProjection = -1, pickCurvePixelSize = -1;
+        GLint pickInstanceProjection = -1;
+        GLint markerProjection = -1, markerViewport = -1, markerSize = -1;
+    } _uniforms;
     glm::mat4 _projection;
 
     Camera2D _camera;
+    // _entities[id] is the entity stored under that id in _store
     std::vector<std::shared_ptr<Entity>> _entities;
+    std::unordered_map<const Entity*, SceneStore::EntityId> _entityIndex;
+    SceneStore _store;
+
+    // The whole vertex pool lives in one VBO, the vertex owners in a parallel one
+    GLuint _sceneVao = 0;
+    GLuint _sceneVbo = 0;
+    GLuint _sceneOwnerVbo = 0;
+    size_t _sceneVboCapacity = 0;   // in floats
+    // Written pool ranges closer than this (floats) go up in one glBufferSubData
+    static constexpr size_t kUploadMergeGap = 1 << 14;
+    std::vector<std::pair<size_t, size_t>> _uploadRanges;
+    GLuint _styleBuffer = 0;        // RGBA8 per entity, read through _styleTexture
+    GLuint _styleTexture = 0;
+    std::vector<std::uint32_t> _styleData;
+    size_t _styleCapacity = 0;      // in entities
+    GLuint _stateBuffer = 0;        // SceneStore state byte per entity, read through _stateTexture
+    GLuint _stateTexture = 0;
+    size_t _stateCapacity = 0;      // in entities
+    bool _dimAll = false;           // highlighted an entity outside the scene
+
+    // Circle and arc instances: all of them grouped by layer, plus the visible
+    // ones streamed each frame when zoomed in. Each layer owns a slice of
+    // _curveVbo with room to grow; a full slice moves to the end with twice the
+    // room, so appending curves only uploads the new ones.
+    struct CurveSlice {
+        std::uint32_t first = 0;    // in instances
+        std::uint32_t count = 0;
+        std::uint32_t capacity = 0;
+    };
+    GLuint _curveVao = 0;
+    GLuint _curveQuadVbo = 0;
+    GLuint _curveVbo = 0;
+    GLuint _curveStreamVbo = 0;
+    size_t _uploadedCurveCount = 0;                 // curves of the store placed in a slice
+    size_t _curveCapacity = 0;                      // instances _curveVbo holds
+    std::vector<CurveSlice> _curveSlices;           // per layer
+    std::vector<SceneStore::CurveInstance> _curveData;  // copy of _curveVbo, gaps included
+    std::vector<std::pair<size_t, size_t>> _curveDirty;
+    std::vector<SceneStore::CurveInstance> _visibleCurves;
+
+    // Culling: entities bucketed by bounding box, built on the first draw and
+    // appended to as entities arrive; a box that changed is filed again
+    TileGrid _grid;
+    bool _gridStale = true;
+    std::vector<SceneStore::EntityId> _visibleIds;
+    SceneStore::DrawList _culledLists[4];     // per draw mode and points, rebuilt every frame
+
+    // Point and box queries: built on first use, appended to as entities
+    // arrive and rebuilt after vertices changed
+    RTree _rtree;
+    bool _spatialIndexStale = true;
+    std::map<std::pair<const BlockDefinition*, LayerTable::LayerId>, BlockBatch> _blockBatches;
+    // Instances of the visible inserts, batch after batch, streamed when zoomed in
+    GLuint _blockStreamVbo = 0;
+    std::vector<InstanceData> _visibleInstances;
+
+    // Bumped when layer visibility or entity styles change; the cached scene
+    // and pick buffer are redrawn when it or the geometry version moves
+    std::uint64_t _appearanceVersion = 0;
+
+    // Static scene rendered once per camera state, composited every frame
+    GLuint _sceneCacheFbo = 0;
+    GLuint _sceneCacheTexture = 0;  // RGBA8, premultiplied
+    GLuint _compositeVao = 0;       // empty, the quad comes from gl_VertexID
+    int _sceneCacheWidth = 0;
+    int _sceneCacheHeight = 0;
+    bool _sceneCacheValid = false;
+    glm::mat4 _sceneCacheViewProj{ 1.0f };
+    std::uint64_t _sceneCacheGeometryVersion = 0;
+    std::uint64_t _sceneCacheAppearanceVersion = 0;
+
+    // Overlay of the selected and hovered entities, rebuilt every frame
+    std::vector<SceneStore::EntityId> _overlayIds;
+    SceneStore::DrawList _overlayLists[4];
+    std::vector<SceneStore::CurveInstance> _overlayCurves;
+    std::vector<SceneStore::EntityId> _overlayInserts;
+    // Batch and instance index of every insert
+    std::unordered_map<SceneStore::EntityId, std::pair<BlockBatch*, std::uint32_t>> _insertSlots;
+
+    // Picking: entity id + 1 per pixel, kept while view and scene are unchanged
+    GLuint _pickFbo = 0;
+    GLuint _pickTexture = 0;
+    int _pickWidth = 0;
+    int _pickHeight = 0;
+    bool _pickValid = false;
+    glm::mat4 _pickViewProj{ 1.0f };
+    std::uint64_t _pickGeometryVersion = 0;
+    std::uint64_t _pickAppearanceVersion = 0;
+    std::vector<std::uint32_t> _pickPixels;
+
+    // Markers: position and RGBA8 color per instance, the quad comes from gl_VertexID
+    struct MarkerInstance {
+        float x, y;
+        std::uint32_t rgba;
+    };
+    std::vector<MarkerInstance> _markers;
+    std::vector<float> _markerBounds;       // a point box per marker, for _markerTree
+    RTree _markerTree;
+    bool _markerTreeStale = true;
+    GLuint _markerVao = 0;
+    GLuint _markerVbo = 0;
+    size_t _markerCapacity = 0;             // instances the buffer has room for
+    size_t _markerDirtyBegin = 0;           // instances changed since the last upload
+    size_t _markerDirtyEnd = 0;
+
+    // Frame instrumentation; GL_TIME_ELAPSED results are read frames later, so
+    // a few queries rotate and a frame goes unmeasured if all are still pending
+    FrameStats _frameStats;
+    static constexpr size_t kGpuQueryCount = 4;
+    GLuint _gpuQueries[kGpuQueryCount] = {};
+    bool _gpuQueryPending[kGpuQueryCount] = {};
+    size_t _gpuQueryNext = 0;
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Dxfloader.h"
+#include "Entities/Block.h"
+#include "Entities/Entity.h"
+#include "LayerTable.h"
+
+// Versioned binary cache of a loaded drawing, stored next to the DXF as
+// "<file>.dxfcache". The file is a flat little-endian layout that is mapped
+// into memory on load: a header, the layer table, the records the loader
+// skipped per type, the block definitions, one
+// fixed-size record per entity, the polyline bulge vertices and the
+// tessellated vertex pool. Model space records come first, then the members
+// of each block; an insert refers to its block by index.
+// It is keyed by the size and content hash of the source DXF.
+class SceneCache
+{
+public:
+    static constexpr std::uint32_t VERSION = 5;
+
+    static std::string cachePathFor(const std::string& dxfPath);
+
+    // Returns false on a miss (no cache, stale key, other version or corrupt file).
+    // On a hit the entities are rebuilt without parsing or tessellating, and
+    // the blocks their inserts refer to are built again from the cached vertices.
+    static bool load(const std::string& dxfPath,
+        std::vector<std::shared_ptr<Entity>>& entities, LayerTable& layers, DxfLoadReport& report);
+
+    // Best effort; a read-only directory simply leaves the drawing uncached.
+    // The skip counts of the report are kept, so a hit reports them as well.
+    static bool save(const std::string& dxfPath, const std::vector<std::shared_ptr<Entity>>& entities,
+        const std::map<std::string, std::shared_ptr<BlockDefinition>>& blocks, const LayerTable& layers,
+        const DxfLoadReport& report);
+};
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Entities/Entity.h"
+#include "LayerTable.h"
+
+// Data-oriented copy of the drawn scene. Every per-entity attribute lives in
+// its own contiguous array indexed by a stable entity id, and all tessellated
+// vertices share one pool, so drawing, picking and highlighting walk flat
+// memory instead of chasing Entity pointers.
+// Circles and arcs keep no vertices here; they are stored as compact curve
+// instances and drawn from their parameters.
+// Ids are handed out in insertion order and stay valid until clear().
+class SceneStore
+{
+public:
+    using EntityId = std::uint32_t;
+    static constexpr EntityId INVALID_ID = ~EntityId(0);
+
+    enum class Kind : std::uint8_t { Line, Circle, Arc, Polyline, Insert, Other };
+
+    // Parameters of a circle or arc; a full circle has a sweep of 2pi
+    struct CurveInstance {
+        float cx, cy, radius;
+        float startAngle, sweep;
+        EntityId id;
+    };
+
+    // Copies the entity's attributes, vertices and LOD levels; the entity is not referenced afterwards.
+    EntityId add(const Entity& entity);
+    // Re-reads the vertices and LOD levels of an entity, e.g. after re-tessellation.
+    // Writes in place when they fit the old range, else moves to a freed range
+    // that fits or to the end of the pool.
+    void updateGeometry(EntityId id, const Entity& entity);
+    // Re-reads the box of an entity drawn elsewhere, e.g. an insert whose block was rebuilt
+    void updateBounds(EntityId id, const Entity& entity);
+    void clear();
+
+    size_t size() const { return _kinds.size(); }
+
+    Kind getKind(EntityId id) const { return _kinds[id]; }
+    Entity::DrawMode getDrawMode(EntityId id) const { return _modes[id]; }
+    const float* getColor(EntityId id) const { return &_colors[id * 3]; }
+    float getAlpha(EntityId id) const { return _alphas[id]; }
+    std::uint32_t getLayerId(EntityId id) const { return _layerIds[id]; }
+    const std::string& getLayerName(std::uint32_t layerId) const { return _layers.get(layerId).name; }
+    const float* getBounds(EntityId id) const { return &_bounds[id * 4]; }
+    // minX, minY, maxX, maxY of every entity in id order
+    const std::vector<float>& getAllBounds() const { return _bounds; }
+    // Changes whenever an entity is added, cleared or gets new vertices
+    std::uint64_t getGeometryVersion() const { return _geometryVersion; }
+    std::uint32_t getVertexFirst(EntityId id) const { return _vertexFirst[id]; }
+    std::uint32_t getVertexCount(EntityId id) const { return _vertexCount[id]; }
+
+    // Layers of the stored entities; visibility changes take effect on the next draw and pick
+    LayerTable& getLayers() { return _layers; }
+    const LayerTable& getLayers() const { return _layers; }
+    // Entities on a layer in insertion order
+    const std::vector<EntityId>& getLayerEntities(std::uint32_t layerId) const;
+
+    void setAlpha(EntityId id, float alpha) { _alphas[id] = alpha; markStyleDirty(id); }
+
+    // Interaction state per entity, one byte each, read by the shaders.
+    // Changing it only touches the affected entries.
+    enum StateFlag : std::uint8_t { Selected = 1, Hovered = 2 };
+    std::uint8_t getState(EntityId id) const { return _states[id]; }
+    const std::vector<std::uint8_t>& getStates() const { return _states; }
+    void setSelected(EntityId id, bool selected);
+    // Costs the number of selected entities, not the scene size
+    void clearSelection();
+    const std::vector<EntityId>& getSelection() const { return _selection; }
+    // At most one hovered entity; INVALID_ID clears it
+    void setHovered(EntityId id);
+    EntityId getHovered() const { return _hovered; }
+    // Sorted [begin, end) runs of state entries changed since the last
+    // markUploaded(); nearby ids share a run, and past a few dozen runs they
+    // fold into one span
+    const std::vector<std::pair<size_t, size_t>>& getStateDirtyRuns() const { return _stateDirtyRuns; }
+
+    // x,y pairs of every entity's vertices
+    const std::vector<float>& getVertexPool() const { return _vertexPool; }
+    // Every circle and arc, in id order. Only ever appended to until clear().
+    const std::vector<CurveInstance>& getCurves() const { return _curves; }
+    bool isCurve(EntityId id) const { return _curveOf[id] != INVALID_ID; }
+    const CurveInstance& getCurve(EntityId id) const { return _curves[_curveOf[id]]; }
+
+    // Entity id of every vertex in the pool, so a shader can look up per-entity attributes
+    const std::vector<EntityId>& getVertexOwners() const { return _vertexOwners; }
+    // Color and alpha of every entity as RGBA8, for a per-entity attribute buffer.
+    // Sized to the scene; only the entries in the style dirty runs are repacked.
+    void packStyles(std::vector<std::uint32_t>& rgba) const;
+    // Set when entities were added or a color or alpha changed since the last markUploaded()
+    bool isStyleDirty() const { return !_styleDirtyRuns.empty(); }
+    // Runs of changed style entries, kept like the state runs
+    const std::vector<std::pair<size_t, size_t>>& getStyleDirtyRuns() const { return _styleDirtyRuns; }
+
+    // Vertex ranges of the drawn entities on one layer with one draw mode,
+    // ready for glMultiDrawArrays. Entities without vertices are left out.
+    struct DrawList {
+        std::vector<std::int32_t> first;
+        std::vector<std::int32_t> count;
+    };
+    // Brings the draw lists up to date after vertices moved; cheap when nothing did
+    void updateDrawLists();
+    const DrawList& getDrawList(std::uint32_t layerId, Entity::DrawMode mode) const;
+    // Single vertices of entities smaller than a pixel, drawn as GL_POINTS
+    const DrawList& getPointList(std::uint32_t layerId) const;
+
+    // World size of a pixel the draw lists are built for. Entities draw their
+    // coarsest LOD level whose tolerance is below it, and collapse to a point
+    // when they fit inside it. 0 draws everything in full.
+    void setLodPixelSize(float worldPerPixel);
+    float getLodPixelSize() const { return _lodPixelSize; }
+
+    // Vertex range an entity is drawn with at the current pixel size, and the
+    // draw list it belongs in: its draw mode, or POINT_LIST
+    static constexpr size_t POINT_LIST = 3;
+    struct DrawRange {
+        std::int32_t first;
+        std::int32_t count;
+        size_t list;
+    };
+    DrawRange getDrawRange(EntityId id) const;
+
+    // Exact distance from the point to the entity's segments or curve; -1 for
+    // entities whose geometry is not in the store (inserts)
+    float distanceTo(EntityId id, float x, float y) const;
+    // 1 if any part of the entity lies in the rectangle (minX, minY, maxX, maxY),
+    // 0 if not, -1 for entities whose geometry is not in the store
+    int touchesRect(EntityId id, const float rect[4]) const;
+
+    // Ranges of the vertex pool (in floats) written since the last markUploaded(),
+    // sorted, with ranges less than mergeGap floats apart joined so they upload
+    // in few calls. isRebuilt() means everything must be uploaded again.
+    void getDirtyRanges(size_t mergeGap, std::vector<std::pair<size_t, size_t>>& out) const;
+    bool isRebuilt() const { return _rebuilt; }
+    void markUploaded();
+
+private:
+    void markDirty(size_t begin, size_t end);
+    void setStateFlag(EntityId id, std::uint8_t flag, bool on);
+    void markStateDirty(EntityId id);
+    void markStyleDirty(EntityId id);
+    void compact();
+    std::uint32_t allocateRange(EntityId id, std::uint32_t count);
+    void writeVertices(EntityId id, const Entity& entity);
+    void appendToDrawList(EntityId id);
+
+    std::vector<Kind> _kinds;
+    std::vector<Entity::DrawMode> _modes;
+    std::vector<float> _colors;             // 3 per entity
+    std::vector<float> _alphas;
+    std::vector<std::uint32_t> _layerIds;
+    std::vector<float> _bounds;             // minX, minY, maxX, maxY per entity
+    std::vector<std::uint32_t> _vertexFirst; // in vertices
+    std::vector<std::uint32_t> _vertexCount;
+    std::vector<std::uint32_t> _vertexCapacity; // room reserved in the pool for in-place rewrites
+
+    // LOD levels live in the entity's pool range right after its full vertices
+    struct LodRange {
+        float tolerance;
+        std::uint32_t offset;               // in vertices from _vertexFirst
+        std::uint32_t count;
+    };
+    std::vector<LodRange> _lods;            // coarsest first per entity
+    std::vector<std::uint32_t> _lodFirst;   // into _lods
+    std::vector<std::uint32_t> _lodCount;
+    float _lodPixelSize = 0.0f;
+
+    LayerTable _layers;
+    std::vector<std::vector<EntityId>> _layerEntities; // per layer id
+
+    static constexpr size_t kDrawListCount = 4; // the draw modes and the points
+    std::vector<DrawList> _drawLists;       // kDrawListCount per layer
+    bool _drawListsDirty = false;           // ranges moved, lists need a rebuild
+
+    std::vector<std::uint8_t> _states;      // StateFlag bits per entity
+    std::vector<EntityId> _selection;
+    EntityId _hovered = INVALID_ID;
+    std::vector<std::pair<size_t, size_t>> _stateDirtyRuns;
+
+    std::vector<CurveInstance> _curves;
+    std::vector<std::uint32_t> _curveOf;    // index into _curves per entity, INVALID_ID if none
+
+    std::vector<float> _vertexPool;
+    std::vector<EntityId> _vertexOwners;    // one per vertex in the pool
+    size_t _garbage = 0;                    // floats in ranges that were moved away
+    // Ranges moved away from, by size in vertices, reused best fit until compact()
+    std::multimap<std::uint32_t, std::uint32_t> _freeRanges;
+    std::vector<std::pair<size_t, size_t>> _dirtyRanges;
+    bool _rebuilt = false;
+    std::vector<std::pair<size_t, size_t>> _styleDirtyRuns;
+    std::uint64_t _geometryVersion = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Red-blue overlap search for the split: boxes of x-monotone curve pieces in
+// two sets are swept left to right. A piece enters the sweep at its min x and
+// leaves after its max x; the active pieces of each set sit in an interval
+// tree on y, so an entering piece finds the pieces of the other set it
+// overlaps in O(log n) plus the number found. The whole run is
+// O((n + k) log n) for n pieces and k overlapping pairs, instead of testing
+// every pair. Exact intersections are left to the caller.
+class SegmentSweep
+{
+public:
+    // A box (minX, minY, maxX, maxY) in set 0 or 1; owner is reported in the pairs.
+    // Boxes that are not finite are ignored.
+    void add(int set, const float box[4], std::uint32_t owner);
+    void clear();
+    size_t size() const { return _pieces.size(); }
+
+    // (owner in set 0, owner in set 1) of every pair of overlapping boxes,
+    // sorted and without repeats when several pieces share an owner
+    void run(std::vector<std::pair<std::uint32_t, std::uint32_t>>& pairs) const;
+
+private:
+    struct Piece {
+        float box[4];
+        std::uint32_t owner;
+        std::uint8_t set;
+    };
+    std::vector<Piece> _pieces;
+};
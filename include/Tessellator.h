@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Entities/Entity.h"
+
+// Tessellation as a stage of its own after parsing. The parser only records
+// bulge vertices and curve parameters; this stage computes the vertices of a
+// batch of entities on all cores. Work is handed out by vertex count, so a
+// batch of small entities and a piece of one long polyline cost about the
+// same, and the vertices of a split polyline are written straight into one
+// array sized up front. The worker threads are started by the first batch
+// that needs them and wait for the next one, so a load tessellating chunk by
+// chunk starts them once.
+class Tessellator
+{
+public:
+    // threads 0 uses one per core; the calling thread is one of them
+    explicit Tessellator(unsigned threads = 0);
+    ~Tessellator();
+    Tessellator(const Tessellator&) = delete;
+    Tessellator& operator=(const Tessellator&) = delete;
+
+    // Computes the vertices of every entity within chordTolerance (world
+    // units) and returns how many were written. Polylines are always
+    // tessellated, other entities only if they have curves. Entities must
+    // not be read by other threads meanwhile.
+    size_t run(const std::vector<std::shared_ptr<Entity>>& entities, float chordTolerance);
+
+    // Heap allocations the worker threads made in run() so far. Those of the
+    // calling thread are in its MemoryStats::threadAllocationCount().
+    std::uint64_t getWorkerAllocationCount() const { return _workerAllocations; }
+
+    // Source vertices per unit of work; longer polylines are split
+    static constexpr size_t kGrainVertices = 4096;
+
+private:
+    // fn(i) for every i in [0, count) on the workers and the calling thread;
+    // indices are handed out one at a time so uneven items balance out
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+    void workerLoop();
+
+    unsigned _threads;
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const std::function<void(size_t)>* _job = nullptr;
+    size_t _jobCount = 0;
+    std::atomic<size_t> _next{ 0 };
+    std::uint64_t _jobGeneration = 0;
+    unsigned _busy = 0;             // workers still on the current job
+    bool _stop = false;
+    std::uint64_t _workerAllocations = 0; // added by each worker when it leaves a job
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over the bounding boxes of a scene, for finding what lies in
+// a rectangle without visiting every entity. Cells are sized from the scene
+// extent and entity count; an entity is listed in every cell its box touches,
+// except very large ones, which are kept in a separate list and box tested.
+// Boxes appended or moved to other cells after a build wait in a tail that is
+// box tested; the grid is rebuilt once the tail outgrows a fraction of it.
+class TileGrid
+{
+public:
+    // bounds holds minX, minY, maxX, maxY per entity; boxes with min > max are left out.
+    // The vector is referenced, not copied, and must outlive the grid.
+    void build(const std::vector<float>& bounds);
+    // Takes in the boxes appended to the bounds since the last build or update
+    void update();
+    // Files the box of an entity again after it changed. It stays in its cells
+    // if it still covers the same ones, and goes to the tail otherwise.
+    void move(std::uint32_t id);
+    void clear();
+
+    // Appends each entity whose box overlaps the rectangle exactly once
+    void query(float minX, float minY, float maxX, float maxY, std::vector<std::uint32_t>& out) const;
+
+    // True when the rectangle covers every entity, so a query would return all of them
+    bool covers(float minX, float minY, float maxX, float maxY) const;
+
+    int getColumns() const { return _columns; }
+    int getRows() const { return _rows; }
+
+private:
+    enum class Filed : std::uint8_t { None, Cells, Large, Tail };
+
+    int cellX(float x) const;
+    int cellY(float y) const;
+    bool isLarge(const float* b) const;
+    void addToTail(std::uint32_t id);
+
+    const std::vector<float>* _bounds = nullptr;
+    size_t _count = 0;                      // entities taken in, built or in the tail
+    float _extent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };   // of the cells
+    float _reach[4] = { 0.0f, 0.0f, 0.0f, 0.0f };    // of every box, the tail included
+    float _cellWidth = 1.0f;
+    float _cellHeight = 1.0f;
+    int _columns = 0;
+    int _rows = 0;
+    std::vector<std::uint32_t> _cellStart;  // _columns * _rows + 1 offsets into _cellItems
+    std::vector<std::uint32_t> _cellItems;
+    std::vector<std::uint32_t> _large;      // spans too many cells to list in each
+    std::vector<std::uint32_t> _tail;
+    std::vector<Filed> _filed;              // per entity, where its box is listed
+    std::vector<std::uint16_t> _cellRect;   // x0, y0, x1, y1 per entity listed in cells
+    size_t _built = 0;                      // boxes in cells or the large list at the last build
+};
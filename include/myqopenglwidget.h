@@ -7,7 +7,16 @@
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QStandardItemModel>
+#include <QThread>
+#include <QTimer>
+#include <QPointer>
+#include <QRubberBand>
+#include <QLabel>
+#include <QElapsedTimer>
 #include <glm/vec2.hpp>
+#include <atomic>
+#include <climits>
+#include <utility>
 
 class MyQOpenGLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core  
 {  
@@ -16,20 +25,37 @@ public:
    explicit MyQOpenGLWidget(QWidget* parent = nullptr);  
    ~MyQOpenGLWidget() override;  
 
-   // Add the missing method declaration  
+   // Parses and tessellates on a worker thread; entities enter the scene store
+   // on the GUI thread in time-sliced batches. Entities are drawn and added to the
+   // tree chunk by chunk while parsing continues. Progress is reported via LoadProgress.
    void loadDxf(const QString& fileName);
+   // Statistics of the most recent completed load
+   const DxfLoadReport& getLoadReport() const { return m_loadReport; }
+   bool isLoading() const { return m_loadThread != nullptr || m_uploadTimer->isActive() || m_parseDone; }
    void highlightSelectedEntity(Entity* selectedEntity);
    void addIntersectionPoints(const std::vector<glm::vec2>& points);
    void addEntities(const std::vector<std::shared_ptr<Entity>>& entities);
    const std::vector<std::shared_ptr<Entity>>& getEntities() const;
+
+   // Layers of the loaded drawing; toggling redraws without touching any buffer
+   const LayerTable& getLayers() const;
+   void setLayerVisible(const QString& name, bool visible);
+   void isolateLayer(const QString& name);
+   std::vector<std::shared_ptr<Entity>> getLayerEntities(const QString& name,
+       std::vector<std::shared_ptr<Entity>>* otherLayers = nullptr) const;
    QString getLoadedFilePath() const { return m_loadedFilePath; }
 
 public slots:
 	void OnClearDxf();
+	void OnCancelLoad();
+	// Frame time, GPU time, draw call and buffer memory readout over the view
+	void setFrameStatsVisible(bool visible);
 signals:
 	void MouseMoved(const QPointF&);
 	void UpdateTreeModel(QStandardItemModel* model);
 	void EntitySelected(Entity* entity);
+	void LoadProgress(qint64 bytesRead, qint64 totalBytes);
+	void LoadFinished(bool success);
 
 protected:  
    void initializeGL() override;  
@@ -45,9 +71,98 @@ protected:
 
 
 private:  
+   // layers is set on the first chunk and with the final result, null otherwise
+   void onChunkParsed(quint64 generation, const std::vector<std::shared_ptr<Entity>>& chunk,
+       const QList<QStandardItem*>& items, const std::shared_ptr<const LayerTable>& layers);
+   void onDxfParsed(quint64 generation, bool ok, const DxfLoadReport& report,
+       const std::shared_ptr<const LayerTable>& layers);
+   void uploadPendingBatch();
+   // Stops any parse or upload in flight; returns true if one was running.
+   bool stopLoading();
+   // Entity under a widget position, from the renderer's id buffer; from the
+   // R-tree while a load is in progress
+   Entity* pickEntityAt(const QPoint& pos);
+   static constexpr int kPickRadiusPx = 5;
+   // Ctrl held toggles a clicked entity, or adds the boxed ones to the selection
+   void selectAt(const QPoint& pos, bool toggle);
+   void selectInBox(const QPoint& start, const QPoint& end, bool add);
+
+   // Re-tessellates curves on a worker thread once the zoom crosses into
+   // another LOD level or the view leaves the area done last; results are
+   // swapped in a time slice at a time. Only entities around the view are
+   // redone, the rest keep whatever level they have until they come into view.
+   // The worker also makes the LOD levels, so the GUI thread only moves them in.
+   // Block members are tessellated for the largest scale their block is drawn
+   // at in that area; the blocks are rebuilt and re-uploaded once the members are all in.
+   struct TessellatedEntity {
+      std::shared_ptr<Entity> entity;
+      std::vector<float> vertices;
+      std::vector<Entity::LodLevel> lodLevels;
+   };
+   struct TessellationResult {
+      std::vector<TessellatedEntity> entities;
+      std::vector<TessellatedEntity> blockMembers;
+      // Blocks to rebuild: all those reached once any member changed, since
+      // nested blocks flatten their children. Kept alive by the inserts of the scene.
+      std::vector<BlockDefinition*> blocks;
+      std::vector<std::pair<BlockDefinition*, float>> blockTolerances; // of the re-tessellated ones
+   };
+   void updateTessellation();
+   void onTessellated(quint64 generation, TessellationResult results);
+   void applyTessellationBatch();
+   void stopTessellation();
+
    std::unique_ptr<Render2D> m_renderer;
    Entity* m_selectedEntity = nullptr;
+
+   // Frame statistics overlay, refreshed from paintGL a few times a second
+   void updateFrameStatsLabel();
+   static constexpr qint64 kStatsRefreshMs = 250;
+   QLabel* m_statsLabel = nullptr;
+   QElapsedTimer m_statsRefresh;
+   Entity* m_hoveredEntity = nullptr;
+   // Intersection markers; the hovered one is lit and shows its coordinates
+   static constexpr float kMarkerColor[3] = { 1.0f, 1.0f, 0.0f };
+   static constexpr float kHoveredMarkerColor[3] = { 1.0f, 1.0f, 1.0f };
+   size_t m_hoveredMarker = Render2D::NO_MARKER;
+   void setHoveredMarker(size_t marker, const QPoint& globalPos);
+   // Mouse moves only record the position; the timer picks once per interval
+   void updateHover();
+   QTimer* m_hoverTimer = nullptr;
+   QPoint m_hoverPos;
+   QPoint m_hoverGlobalPos;
+
+   // Left-drag box selection
+   static constexpr int kDragThresholdPx = 4;
+   bool m_leftPressed = false;
+   bool m_boxSelecting = false;
+   QPoint m_boxStart;
+   QRubberBand* m_rubberBand = nullptr;
    QPoint m_lastMousePos;
    bool m_panning = false;
    QString m_loadedFilePath;
+
+   // Background loading
+   QThread* m_loadThread = nullptr;
+   std::atomic<bool> m_cancelLoad{ false };
+   quint64 m_loadGeneration = 0; // discards results of superseded loads
+   QTimer* m_uploadTimer = nullptr;
+   std::vector<std::shared_ptr<Entity>> m_pendingUpload;
+   size_t m_uploadIndex = 0;
+   bool m_parseDone = false;     // parser finished, upload may still be catching up
+   QPointer<QStandardItemModel> m_treeModel; // owned by the main window
+   DxfLoadReport m_loadReport;
+
+   // Zoom-dependent tessellation
+   static constexpr int kStaleTessLevel = INT_MIN;
+   int m_tessLevel = kStaleTessLevel; // LOD level of the area below and of entities added since
+   float m_tessRect[4] = { 0.0f, 0.0f, -1.0f, -1.0f }; // world area brought to m_tessLevel
+   std::vector<int> m_entityTessLevels;  // per entity of the renderer
+   std::unordered_map<const BlockDefinition*, float> m_blockTolerances; // chord tolerance of the members
+   QThread* m_tessThread = nullptr;
+   std::atomic<bool> m_cancelTess{ false };
+   quint64 m_tessGeneration = 0;
+   QTimer* m_tessApplyTimer = nullptr;
+   TessellationResult m_pendingTess;
+   size_t m_tessIndex = 0;
 };
@@ -7,7 +7,10 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QTimer>
-#include <algorithm>
+#include <QColor>
+
+// Layer name of the items under the "Layers" branch
+static constexpr int kLayerNameRole = Qt::UserRole + 1;
 
 AutoDxfCpp::AutoDxfCpp(bool showMenu, QWidget* parent)
     : QMainWindow(parent), m_showMenu(showMenu)
@@ -26,17 +29,35 @@ AutoDxfCpp::AutoDxfCpp(bool showMenu, QWidget* parent)
     ui.centralWidget->setLayout(new QVBoxLayout());
     ui.centralWidget->layout()->addWidget(m_oglWidget);
 
+    // Load progress, only visible while a file is loading
+    m_loadProgress = new QProgressBar(this);
+    m_loadProgress->setRange(0, 100);
+    m_loadProgress->setMaximumWidth(200);
+    m_loadProgress->hide();
+    ui.statusBar->addPermanentWidget(m_loadProgress);
+
+    // Summary of the last load; per-type and per-layer counts in the tooltip
+    m_loadReportLabel = new QLabel(this);
+    ui.statusBar->addPermanentWidget(m_loadReportLabel);
+
     // Top Menu
 	connect(ui.actionLoad, &QAction::triggered, this, &AutoDxfCpp::OnLoadDxf);
+	connect(ui.actionCancelLoad, &QAction::triggered, m_oglWidget, &MyQOpenGLWidget::OnCancelLoad);
 	connect(ui.actionClear, &QAction::triggered, m_oglWidget, &MyQOpenGLWidget::OnClearDxf);
 	connect(ui.actionSplit, &QAction::triggered, this, &AutoDxfCpp::OnSplit);
+    connect(ui.actionFrameStats, &QAction::toggled, m_oglWidget, &MyQOpenGLWidget::setFrameStatsVisible);
     connect(m_oglWidget, &MyQOpenGLWidget::MouseMoved, this, &AutoDxfCpp::OnMouseMoved);
+    connect(m_oglWidget, &MyQOpenGLWidget::LoadProgress, this, &AutoDxfCpp::OnLoadProgress);
+    connect(m_oglWidget, &MyQOpenGLWidget::LoadFinished, this, &AutoDxfCpp::OnLoadFinished);
 
     // Tree View
     ui.treeView->setHeaderHidden(true);
     connect(m_oglWidget, &MyQOpenGLWidget::UpdateTreeModel, this, &AutoDxfCpp::OnUpdateTreeModel);
     connect(ui.treeView, &QTreeView::clicked,
         this, &AutoDxfCpp::onTreeItemClicked);
+    // Double-clicking a layer shows only that layer
+    connect(ui.treeView, &QTreeView::doubleClicked,
+        this, &AutoDxfCpp::onTreeItemDoubleClicked);
 	connect(m_oglWidget, &MyQOpenGLWidget::EntitySelected,
 		this, &AutoDxfCpp::onEntitySelectedInViewport);
 }
@@ -52,12 +73,63 @@ void AutoDxfCpp::OnMouseMoved(const QPointF& pos)
         .arg(pos.y(), 0, 'f', 2));
 }
 
+void AutoDxfCpp::OnLoadProgress(qint64 bytesRead, qint64 totalBytes)
+{
+    int percent = totalBytes > 0 ? static_cast<int>(bytesRead * 100 / totalBytes) : 0;
+    m_loadProgress->setValue(percent);
+}
+
+void AutoDxfCpp::OnLoadFinished(bool success)
+{
+    m_loadProgress->hide();
+    ui.actionCancelLoad->setEnabled(false);
+    ui.statusBar->showMessage(success ? tr("Load complete") : tr("Load cancelled or failed"), 3000);
+
+    if (!success) {
+        m_loadReportLabel->clear();
+        m_loadReportLabel->setToolTip(QString());
+        return;
+    }
+
+    if (auto* model = qobject_cast<QStandardItemModel*>(ui.treeView->model()))
+        addLayerTree(model);
+
+    const DxfLoadReport& report = m_oglWidget->getLoadReport();
+    m_loadReportLabel->setText(
+        QString("%1 entities, %2 vertices, %3 skipped | %4 %5 ms, tessellate %6 ms, upload %7 ms, tree %8 ms | %9 allocs, peak %10 MB")
+        .arg(static_cast<qulonglong>(report.entityCount))
+        .arg(static_cast<qulonglong>(report.vertexCount))
+        .arg(static_cast<qulonglong>(report.skippedCount))
+        .arg(report.fromCache ? tr("cache") : tr("parse"))
+        .arg(report.parseMs, 0, 'f', 0)
+        .arg(report.tessellateMs, 0, 'f', 0)
+        .arg(report.uploadMs, 0, 'f', 0)
+        .arg(report.treeBuildMs, 0, 'f', 0)
+        .arg(static_cast<qulonglong>(report.allocationCount))
+        .arg(report.peakRssBytes / (1024.0 * 1024.0), 0, 'f', 0));
+
+    QString details = tr("Entities by type:");
+    for (const auto& [type, count] : report.entitiesByType)
+        details += QString("\n  %1: %2").arg(QString::fromStdString(type)).arg(static_cast<qulonglong>(count));
+    details += tr("\nEntities by layer:");
+    for (const auto& [layer, count] : report.entitiesByLayer)
+        details += QString("\n  %1: %2").arg(QString::fromUtf8(layer)).arg(static_cast<qulonglong>(count));
+    details += tr("\nDocument arena: %1 KB").arg(static_cast<qulonglong>(report.arenaBytes / 1024));
+    details += tr("\nSkipped (unsupported):");
+    for (const auto& [type, count] : report.skippedByType)
+        details += QString("\n  %1: %2").arg(QString::fromStdString(type)).arg(static_cast<qulonglong>(count));
+    m_loadReportLabel->setToolTip(details);
+}
+
 void AutoDxfCpp::OnLoadDxf()
 {
     QString fileName = QFileDialog::getOpenFileName(this, tr("Open DXF File"), "", tr("DXF Files (*.dxf)"));
     if (fileName.isEmpty())
         return;
 
+    m_loadProgress->setValue(0);
+    m_loadProgress->show();
+    ui.actionCancelLoad->setEnabled(true);
     m_oglWidget->loadDxf(fileName);
 }
 
@@ -75,67 +147,21 @@ void AutoDxfCpp::OnSplit()
     if (!ok || cutterLayer.isEmpty())
         return;
 
-    const auto& entities = m_oglWidget->getEntities();
-
-    std::vector<Polyline*> trimlines;
-    std::vector<Polyline*> ogPolylines;
-
-    for (const auto& entity : entities) {
-        Polyline* poly = dynamic_cast<Polyline*>(entity.get());
-        if (!poly) continue;
+    // Cutters straight from the layer index instead of testing every entity's layer
+    std::vector<std::shared_ptr<Entity>> otherEntities;
+    std::vector<std::shared_ptr<Entity>> cutterEntities = m_oglWidget->getLayerEntities(cutterLayer, &otherEntities);
+    auto result = AutoDxfHelper::SplitByCutterLayer(
+        cutterEntities, otherEntities, cutterLayer.toStdString());
 
-        QString layer = QString::fromUtf8(entity->getLayer());
-        if (layer == cutterLayer) {
-            trimlines.push_back(poly);
-        } else {
-            ogPolylines.push_back(poly);
-        }
-    }
-
-    // For each ogPly, collect all intersections from all trimlines, sort, and split
     std::vector<std::shared_ptr<Entity>> trimmedEntities;
-    std::vector<glm::vec2> allIntersectionPts;
-
-    for (auto* ogPly : ogPolylines) {
-        // Accumulate intersections from all trimlines for this ogPly
-        std::vector<AutoDxfHelper::IntersectionPoint> ips;
-        for (auto* trimline : trimlines) {
-            auto hits = AutoDxfHelper::PolylineIntersections(
-                ogPly->getPolyVertices(), ogPly->getIsClosed(),
-                trimline->getPolyVertices(), trimline->getIsClosed());
-            ips.insert(ips.end(), hits.begin(), hits.end());
-        }
-
-        // Collect intersection points for display
-        for (const auto& ip : ips) {
-            allIntersectionPts.push_back(ip.point);
-        }
-
-        // Sort by segmentIndex, then by parameter
-        std::sort(ips.begin(), ips.end(),
-            [](const AutoDxfHelper::IntersectionPoint& a,
-               const AutoDxfHelper::IntersectionPoint& b) {
-                if (a.segmentIndex != b.segmentIndex)
-                    return a.segmentIndex < b.segmentIndex;
-                return a.parameter < b.parameter;
-            });
-
-        // Split the ogPly at intersection points
-        auto subPolys = AutoDxfHelper::SplitPolyline(
-            ogPly->getPolyVertices(), ogPly->getIsClosed(), ips);
-
-        // Create Polyline entities from trimmed results
-        for (auto& verts : subPolys) {
-            if (verts.size() < 2) continue;
-            auto trimmed = std::make_shared<Polyline>(verts, false);
-            trimmed->setColor(0.0f, 1.0f, 0.0f); // Green for trimmed
-            trimmed->setLayer(ogPly->getLayer());
-            trimmedEntities.push_back(trimmed);
-        }
+    for (auto& trimmed : result.polylines) {
+        trimmed->setColor(0.0f, 1.0f, 0.0f); // Green for trimmed
+        trimmedEntities.push_back(trimmed);
     }
+    std::vector<glm::vec2> allIntersectionPts = std::move(result.intersections);
 
-    qDebug() << "Trimlines:" << trimlines.size()
-             << "OgPolylines:" << ogPolylines.size()
+    qDebug() << "Trimlines:" << result.cutterCount
+             << "OgPolylines:" << result.targetCount
              << "Intersection points:" << allIntersectionPts.size()
              << "Trimmed sub-polylines:" << trimmedEntities.size();
 
@@ -163,6 +189,69 @@ void AutoDxfCpp::OnUpdateTreeModel(QStandardItemModel* model)
     }
 
     ui.treeView->setModel(model);
+    m_layerRoot = nullptr;
+    connect(model, &QStandardItemModel::itemChanged, this, &AutoDxfCpp::onTreeItemChanged);
+}
+
+void AutoDxfCpp::addLayerTree(QStandardItemModel* model)
+{
+    const LayerTable& layers = m_oglWidget->getLayers();
+    if (layers.size() == 0) return;
+
+    // Items are filled in before they join the model, so no itemChanged fires here
+    m_layerRoot = new QStandardItem(tr("Layers"));
+    for (LayerTable::LayerId id = 0; id < layers.size(); ++id) {
+        const LayerInfo& layer = layers.get(id);
+        QString name = QString::fromUtf8(layer.name);
+        QStandardItem* item = new QStandardItem(name);
+        item->setData(name, kLayerNameRole);
+        item->setData(QColor::fromRgbF(layer.color[0], layer.color[1], layer.color[2]), Qt::DecorationRole);
+        item->setCheckable(true);
+        item->setCheckState(layer.visible ? Qt::Checked : Qt::Unchecked);
+        if (layer.frozen) {
+            item->setEnabled(false);
+            item->setToolTip(tr("Frozen"));
+        }
+        m_layerRoot->appendRow(item);
+    }
+    model->appendRow(m_layerRoot);
+}
+
+void AutoDxfCpp::syncLayerChecks()
+{
+    if (!m_layerRoot) return;
+    QStandardItemModel* model = m_layerRoot->model();
+    const LayerTable& layers = m_oglWidget->getLayers();
+
+    QSignalBlocker blocker(model);
+    for (int i = 0; i < m_layerRoot->rowCount(); ++i) {
+        QStandardItem* item = m_layerRoot->child(i);
+        LayerTable::LayerId id = layers.find(item->data(kLayerNameRole).toString().toStdString());
+        if (id != LayerTable::INVALID_ID)
+            item->setCheckState(layers.get(id).visible ? Qt::Checked : Qt::Unchecked);
+    }
+    ui.treeView->viewport()->update();
+}
+
+void AutoDxfCpp::onTreeItemChanged(QStandardItem* item)
+{
+    QVariant layer = item->data(kLayerNameRole);
+    if (!layer.isValid()) return;
+    m_oglWidget->setLayerVisible(layer.toString(), item->checkState() == Qt::Checked);
+}
+
+void AutoDxfCpp::onTreeItemDoubleClicked(const QModelIndex& index)
+{
+    QVariant layer = index.data(kLayerNameRole);
+    if (layer.isValid()) {
+        m_oglWidget->isolateLayer(layer.toString());
+        syncLayerChecks();
+    }
+    else if (m_layerRoot && index == m_layerRoot->index()) {
+        // Double-clicking the branch shows every layer again
+        m_oglWidget->isolateLayer(QString());
+        syncLayerChecks();
+    }
 }
 
 void AutoDxfCpp::onTreeItemClicked(const QModelIndex& index) {
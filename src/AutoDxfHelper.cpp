@@ -1,5 +1,10 @@
 #include <glm/ext/scalar_constants.hpp>
 #include "AutoDxfHelper.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Entities/Insert.h"
+#include "SegmentSweep.h"
 
 static float PI = glm::pi<float>();
 glm::vec2 AutoDxfHelper::CenterFromBulge(const glm::vec2& p1, const glm::vec2& p2, float bulge)
@@ -33,6 +38,26 @@ float AutoDxfHelper::RadiusFromBulge(const glm::vec2& p1, const glm::vec2& p2, f
 	return glm::distance(CenterFromBulge(p1, p2, bulge), p1);
 }
 
+int AutoDxfHelper::ArcSegments(float radius, float sweep, float chordTolerance, int minSegments)
+{
+	sweep = std::abs(sweep);
+	if (!std::isfinite(radius) || !std::isfinite(sweep) || !std::isfinite(chordTolerance)
+		|| radius <= chordTolerance || chordTolerance <= 0.f)
+		return minSegments;
+
+	// Sagitta of a chord spanning angle a: r * (1 - cos(a / 2)). In double, and
+	// in the small-angle form 1 - cos(x) ~ x^2 / 2 once the ratio is tiny, since
+	// 1 - ratio rounds to 1 for deep zooms on large arcs and the step to 0.
+	const double ratio = static_cast<double>(chordTolerance) / radius;
+	const double maxStep = ratio < 1e-6 ? 2.0 * std::sqrt(2.0 * ratio) : 2.0 * std::acos(1.0 - ratio);
+	if (!(maxStep > 0.0))
+		return MAX_ARC_SEGMENTS;
+	const double segments = std::ceil(sweep / maxStep);
+	if (!(segments < MAX_ARC_SEGMENTS))
+		return std::max(minSegments, MAX_ARC_SEGMENTS);
+	return std::clamp(static_cast<int>(segments), minSegments, MAX_ARC_SEGMENTS);
+}
+
 // Normalize `angle` into the half-open range [base, base + 2��).
 static float NormalizeAngle(float angle, float base)
 {
@@ -41,6 +66,97 @@ static float NormalizeAngle(float angle, float base)
 	return angle;
 }
 
+float AutoDxfHelper::DistanceToArc(const glm::vec2& p, const glm::vec2& center, float radius,
+	float startAngle, float sweep)
+{
+	glm::vec2 d = p - center;
+	float onCircle = std::abs(glm::length(d) - radius);
+	if (sweep >= 2.f * PI)
+		return onCircle;
+
+	if (NormalizeAngle(std::atan2(d.y, d.x), startAngle) - startAngle <= sweep)
+		return onCircle;
+
+	// Outside the sweep the nearest point is an endpoint
+	float endAngle = startAngle + sweep;
+	glm::vec2 p0 = center + radius * glm::vec2(std::cos(startAngle), std::sin(startAngle));
+	glm::vec2 p1 = center + radius * glm::vec2(std::cos(endAngle), std::sin(endAngle));
+	return std::min(glm::length(p - p0), glm::length(p - p1));
+}
+
+void AutoDxfHelper::ArcBounds(const glm::vec2& center, float radius, float startAngle, float sweep, float bounds[4])
+{
+	if (sweep >= 2.f * PI) {
+		bounds[0] = center.x - radius;
+		bounds[1] = center.y - radius;
+		bounds[2] = center.x + radius;
+		bounds[3] = center.y + radius;
+		return;
+	}
+
+	float endAngle = startAngle + sweep;
+	glm::vec2 p0 = center + radius * glm::vec2(std::cos(startAngle), std::sin(startAngle));
+	glm::vec2 p1 = center + radius * glm::vec2(std::cos(endAngle), std::sin(endAngle));
+	bounds[0] = std::min(p0.x, p1.x);
+	bounds[1] = std::min(p0.y, p1.y);
+	bounds[2] = std::max(p0.x, p1.x);
+	bounds[3] = std::max(p0.y, p1.y);
+
+	// 0, 90, 180 and 270 degrees extend the box when the sweep passes them
+	for (int quadrant = 0; quadrant < 4; ++quadrant) {
+		float angle = quadrant * 0.5f * PI;
+		if (NormalizeAngle(angle, startAngle) - startAngle > sweep)
+			continue;
+		glm::vec2 q = center + radius * glm::vec2(std::cos(angle), std::sin(angle));
+		bounds[0] = std::min(bounds[0], q.x);
+		bounds[1] = std::min(bounds[1], q.y);
+		bounds[2] = std::max(bounds[2], q.x);
+		bounds[3] = std::max(bounds[3], q.y);
+	}
+}
+
+void AutoDxfHelper::DouglasPeuckerRanks(const std::vector<float>& xy, std::vector<float>& rank)
+{
+	const size_t count = xy.size() / 2;
+	rank.assign(count, 0.0f);
+	if (count == 0) return;
+	const float infinite = std::numeric_limits<float>::infinity();
+	rank[0] = rank[count - 1] = infinite;
+
+	// A split vertex survives while both its distance and every enclosing
+	// split exceed the tolerance
+	struct Span { size_t a, b; float limit; };
+	std::vector<Span> stack;
+	if (count > 2) stack.push_back({ 0, count - 1, infinite });
+	while (!stack.empty()) {
+		Span span = stack.back();
+		stack.pop_back();
+
+		glm::vec2 a(xy[span.a * 2], xy[span.a * 2 + 1]);
+		glm::vec2 d = glm::vec2(xy[span.b * 2], xy[span.b * 2 + 1]) - a;
+		float lenSq = glm::dot(d, d);
+		size_t split = span.a + 1;
+		float worst = -1.0f;
+		for (size_t i = span.a + 1; i < span.b; ++i) {
+			// Distance to the chord segment, not its line, so the error bound holds at the ends too
+			glm::vec2 p = glm::vec2(xy[i * 2], xy[i * 2 + 1]) - a;
+			float t = lenSq > 0.0f ? std::clamp(glm::dot(p, d) / lenSq, 0.0f, 1.0f) : 0.0f;
+			float dist = glm::length(p - t * d);
+			if (dist > worst) {
+				worst = dist;
+				split = i;
+			}
+		}
+		// Collinear run: every interior vertex stays at rank 0
+		if (worst <= 0.0f) continue;
+
+		float limit = std::min(worst, span.limit);
+		rank[split] = limit;
+		if (split - span.a > 1) stack.push_back({ span.a, split, limit });
+		if (span.b - split > 1) stack.push_back({ split, span.b, limit });
+	}
+}
+
 bool AutoDxfHelper::AngleOnArc(float a1, float a2, float aQ, float bulge)
 {
 	if (bulge > 0.f) {
@@ -300,32 +416,256 @@ std::vector<AutoDxfHelper::IntersectionPoint> AutoDxfHelper::PolylineIntersectio
 	const std::vector<PolylineVertex>& polyA, bool closedA,
 	const std::vector<PolylineVertex>& polyB, bool closedB)
 {
-	std::vector<IntersectionPoint> result;
+	return SweepIntersections({ { &polyA, closedA } }, { { &polyB, closedB } }).front();
+}
+
+static size_t SegmentCount(const AutoDxfHelper::PolylineView& view)
+{
+	size_t vertCount = view.vertices->size();
+	if (vertCount < 2) return 0;
+	return view.closed ? vertCount : vertCount - 1;
+}
+
+static AutoDxfHelper::PolylineSegment SegmentOf(const AutoDxfHelper::PolylineView& view, size_t i)
+{
+	const auto& verts = *view.vertices;
+	const size_t nextI = (i + 1) % verts.size();
+	return { verts[i].position, verts[nextI].position, verts[i].bulge, static_cast<int>(i) };
+}
+
+// How far a hit of the exact intersection tests can lie off a segment: their
+// parameter and angle tolerances, plus float rounding at the coordinate scale
+static float IntersectionPad(float chord, float radius, float scale)
+{
+	return 2.f * AutoDxfHelper::EPSILON * (chord + radius) + AutoDxfHelper::EPSILON
+		+ 8.f * std::numeric_limits<float>::epsilon() * scale;
+}
+
+void AutoDxfHelper::SegmentBounds(const PolylineSegment& seg, float bounds[4])
+{
+	const float chord = glm::distance(seg.start, seg.end);
+	float radius = 0.f;
+	float scale = std::max(std::max(std::abs(seg.start.x), std::abs(seg.start.y)),
+		std::max(std::abs(seg.end.x), std::abs(seg.end.y)));
+	bounds[0] = std::min(seg.start.x, seg.end.x);
+	bounds[1] = std::min(seg.start.y, seg.end.y);
+	bounds[2] = std::max(seg.start.x, seg.end.x);
+	bounds[3] = std::max(seg.start.y, seg.end.y);
+
+	if (seg.isArc()) {
+		glm::vec2 center = CenterFromBulge(seg.start, seg.end, seg.bulge);
+		float arcRadius = glm::distance(center, seg.start);
+		if (std::isfinite(arcRadius)) {
+			// Counter-clockwise from startAngle, whichever way the bulge runs
+			float sweep = 4.f * std::atan(seg.bulge);
+			float startAngle = std::atan2(seg.start.y - center.y, seg.start.x - center.x);
+			if (sweep < 0.f) {
+				startAngle += sweep;
+				sweep = -sweep;
+			}
+			float arcBounds[4];
+			ArcBounds(center, arcRadius, startAngle, sweep, arcBounds);
+			bounds[0] = std::min(bounds[0], arcBounds[0]);
+			bounds[1] = std::min(bounds[1], arcBounds[1]);
+			bounds[2] = std::max(bounds[2], arcBounds[2]);
+			bounds[3] = std::max(bounds[3], arcBounds[3]);
+			radius = arcRadius;
+			scale = std::max(std::abs(center.x), std::abs(center.y)) + radius;
+		}
+	}
+
+	const float pad = IntersectionPad(chord, radius, scale);
+	bounds[0] -= pad;
+	bounds[1] -= pad;
+	bounds[2] += pad;
+	bounds[3] += pad;
+}
 
-	auto segCount = [](size_t vertCount, bool closed) -> size_t {
-		if (vertCount < 2) return 0;
-		return closed ? vertCount : vertCount - 1;
+// Adds the boxes of a segment to the sweep. Arcs are cut at every multiple of
+// 90 degrees, so each piece is monotone in x and y and the box of its endpoints
+// is exact. Boxes grow by the tolerance of the exact intersection tests.
+static void AddSegmentPieces(SegmentSweep& sweep, int set, const AutoDxfHelper::PolylineSegment& seg, uint32_t owner)
+{
+	const float chord = glm::distance(seg.start, seg.end);
+	auto addBox = [&](glm::vec2 a, glm::vec2 b, float radius, float scale) {
+		float pad = IntersectionPad(chord, radius, scale);
+		float box[4] = { std::min(a.x, b.x) - pad, std::min(a.y, b.y) - pad,
+			std::max(a.x, b.x) + pad, std::max(a.y, b.y) + pad };
+		sweep.add(set, box, owner);
+	};
+	auto scaleOf = [](glm::vec2 a, glm::vec2 b) {
+		return std::max(std::max(std::abs(a.x), std::abs(a.y)), std::max(std::abs(b.x), std::abs(b.y)));
+	};
+
+	const glm::vec2 center = AutoDxfHelper::CenterFromBulge(seg.start, seg.end, seg.bulge);
+	const float radius = glm::distance(center, seg.start);
+	if (!seg.isArc() || !std::isfinite(radius)) {
+		addBox(seg.start, seg.end, 0.f, scaleOf(seg.start, seg.end));
+		return;
+	}
+
+	// Counter-clockwise from startAngle, whichever way the bulge runs
+	float sweepAngle = 4.f * std::atan(seg.bulge);
+	float startAngle = std::atan2(seg.start.y - center.y, seg.start.x - center.x);
+	if (sweepAngle < 0.f) {
+		startAngle += sweepAngle;
+		sweepAngle = -sweepAngle;
+	}
+	const float endAngle = startAngle + sweepAngle;
+	const float scale = std::max(std::abs(center.x), std::abs(center.y)) + radius;
+	const float quarter = 0.5f * PI;
+
+	auto pointAt = [&](float angle) { return center + radius * glm::vec2(std::cos(angle), std::sin(angle)); };
+	float from = startAngle;
+	for (float k = std::floor(startAngle / quarter) + 1.f; k * quarter < endAngle; k += 1.f) {
+		addBox(pointAt(from), pointAt(k * quarter), radius, scale);
+		from = k * quarter;
+	}
+	addBox(pointAt(from), pointAt(endAngle), radius, scale);
+}
+
+std::vector<std::vector<AutoDxfHelper::IntersectionPoint>> AutoDxfHelper::SweepIntersections(
+	const std::vector<PolylineView>& targets, const std::vector<PolylineView>& cutters)
+{
+	std::vector<std::vector<IntersectionPoint>> result(targets.size());
+
+	// Owners number the segments of each set: (polyline, segment)
+	std::vector<std::pair<uint32_t, uint32_t>> owners[2];
+	SegmentSweep sweep;
+	auto addSet = [&](int set, const std::vector<PolylineView>& views) {
+		for (uint32_t p = 0; p < views.size(); ++p) {
+			const size_t segs = SegmentCount(views[p]);
+			for (size_t i = 0; i < segs; ++i) {
+				const uint32_t owner = static_cast<uint32_t>(owners[set].size());
+				if (views[p].segmentBounds)
+					sweep.add(set, &views[p].segmentBounds[i * 4], owner);
+				else
+					AddSegmentPieces(sweep, set, SegmentOf(views[p], i), owner);
+				owners[set].emplace_back(p, static_cast<uint32_t>(i));
+			}
+		}
 	};
+	addSet(0, targets);
+	addSet(1, cutters);
+
+	std::vector<std::pair<uint32_t, uint32_t>> pairs;
+	sweep.run(pairs);
 
-	size_t segsA = segCount(polyA.size(), closedA);
-	size_t segsB = segCount(polyB.size(), closedB);
+	// Pairs come sorted by target segment, so each target gets its hits in segment order
+	for (const auto& [targetOwner, cutterOwner] : pairs) {
+		const auto [target, i] = owners[0][targetOwner];
+		const auto [cutter, j] = owners[1][cutterOwner];
+		PolylineSegment segA = SegmentOf(targets[target], i);
+		PolylineSegment segB = SegmentOf(cutters[cutter], j);
+
+		auto hits = IntersectSegments(segA, segB);
+		for (auto& ip : hits) {
+			ip.segmentIndex = static_cast<int>(i);
+			result[target].push_back(ip);
+		}
+	}
 
-	for (size_t i = 0; i < segsA; ++i) {
-		size_t nextI = (i + 1) % polyA.size();
-		PolylineSegment segA{ polyA[i].position, polyA[nextI].position,
-			polyA[i].bulge, static_cast<int>(i) };
+	return result;
+}
 
-		for (size_t j = 0; j < segsB; ++j) {
-			size_t nextJ = (j + 1) % polyB.size();
-			PolylineSegment segB{ polyB[j].position, polyB[nextJ].position,
-				polyB[j].bulge, static_cast<int>(j) };
+AutoDxfHelper::SplitResult AutoDxfHelper::SplitByCutterLayer(
+	const std::vector<std::shared_ptr<Entity>>& entities, const std::string& cutterLayer)
+{
+	std::vector<std::shared_ptr<Entity>> cutterEntities;
+	std::vector<std::shared_ptr<Entity>> otherEntities;
+	for (const auto& entity : entities) {
+		if (entity->getLayer() == cutterLayer) {
+			cutterEntities.push_back(entity);
+		}
+		else {
+			otherEntities.push_back(entity);
+		}
+	}
+	return SplitByCutterLayer(cutterEntities, otherEntities, cutterLayer);
+}
 
-			auto hits = IntersectSegments(segA, segB);
+AutoDxfHelper::SplitResult AutoDxfHelper::SplitByCutterLayer(
+	const std::vector<std::shared_ptr<Entity>>& cutterEntities,
+	const std::vector<std::shared_ptr<Entity>>& otherEntities, const std::string& cutterLayer)
+{
+	SplitResult result;
+
+	std::vector<Polyline*> trimlines;
+	std::vector<Polyline*> ogPolylines;
+	// Polylines of block instances, in world coordinates; kept alive for the split
+	std::vector<std::shared_ptr<Polyline>> instancePolylines;
+
+	// Block entities carry their own layer, whatever layer the insert is on
+	auto addInstance = [&](Insert* insert) {
+		for (auto& poly : insert->getWorldPolylines()) {
+			instancePolylines.push_back(poly);
+			if (poly->getLayer() == cutterLayer) {
+				trimlines.push_back(poly.get());
+			}
+			else {
+				ogPolylines.push_back(poly.get());
+			}
+		}
+	};
 
-			for (auto& ip : hits) {
-				ip.segmentIndex = static_cast<int>(i);
-				result.push_back(ip);
+	auto collect = [&](const std::vector<std::shared_ptr<Entity>>& entities, std::vector<Polyline*>& polylines) {
+		for (const auto& entity : entities) {
+			if (auto* insert = dynamic_cast<Insert*>(entity.get())) {
+				addInstance(insert);
 			}
+			else if (auto* poly = dynamic_cast<Polyline*>(entity.get())) {
+				polylines.push_back(poly);
+			}
+		}
+	};
+	collect(cutterEntities, trimlines);
+	collect(otherEntities, ogPolylines);
+
+	result.cutterCount = trimlines.size();
+	result.targetCount = ogPolylines.size();
+
+	// Intersections of every ogPly with all trimlines in one sweep over the
+	// segment boxes of their cached indexes, held here while the sweep runs
+	std::vector<std::shared_ptr<const Polyline::SegmentIndex>> indexes;
+	indexes.reserve(ogPolylines.size() + trimlines.size());
+	auto viewOf = [&](const Polyline* poly) {
+		indexes.push_back(poly->getSegmentIndex());
+		return PolylineView{ &poly->getPolyVertices(), poly->getIsClosed(), indexes.back()->bounds.data() };
+	};
+	std::vector<PolylineView> targets, cutters;
+	targets.reserve(ogPolylines.size());
+	cutters.reserve(trimlines.size());
+	for (auto* ogPly : ogPolylines)
+		targets.push_back(viewOf(ogPly));
+	for (auto* trimline : trimlines)
+		cutters.push_back(viewOf(trimline));
+	auto allHits = SweepIntersections(targets, cutters);
+
+	// For each ogPly, sort its intersections and split
+	for (size_t p = 0; p < ogPolylines.size(); ++p) {
+		Polyline* ogPly = ogPolylines[p];
+		std::vector<IntersectionPoint>& ips = allHits[p];
+
+		for (const auto& ip : ips) {
+			result.intersections.push_back(ip.point);
+		}
+
+		// Sort by segmentIndex, then by parameter
+		std::sort(ips.begin(), ips.end(),
+			[](const IntersectionPoint& a, const IntersectionPoint& b) {
+				if (a.segmentIndex != b.segmentIndex)
+					return a.segmentIndex < b.segmentIndex;
+				return a.parameter < b.parameter;
+			});
+
+		// Split the ogPly at intersection points
+		auto subPolys = SplitPolyline(ogPly->getPolyVertices(), ogPly->getIsClosed(), ips);
+
+		for (auto& verts : subPolys) {
+			if (verts.size() < 2) continue;
+			auto trimmed = std::make_shared<Polyline>(verts, false);
+			trimmed->setLayer(ogPly->getLayer());
+			result.polylines.push_back(trimmed);
 		}
 	}
 
@@ -1,4 +1,6 @@
 #include <Camera.h>
+#include <algorithm>
+#include <cmath>
 void Camera2D::pan(float dx, float dy) {
     _offset += glm::vec2(dx, dy);
 }
@@ -8,3 +10,19 @@ void Camera2D::zoomAt(float factor, glm::vec2 mousePos) {
     _offset = mousePos - (mousePos - _offset) * factor;
     _zoom *= factor;
 }
+
+float Camera2D::FitScale(float width, float height, const float rect[4], float margin) {
+    float spanX = rect[2] - rect[0];
+    float spanY = rect[3] - rect[1];
+    if (spanX <= 0.0f && spanY <= 0.0f) return 1.0f; // a single point
+    float usable = 1.0f - 2.0f * margin;
+    float scaleX = spanX > 0.0f ? width * usable / spanX : INFINITY;
+    float scaleY = spanY > 0.0f ? height * usable / spanY : INFINITY;
+    return std::min(scaleX, scaleY);
+}
+
+void Camera2D::fitRect(const float rect[4], float margin) {
+    _zoom = FitScale(_width, _height, rect, margin);
+    glm::vec2 center((rect[0] + rect[2]) * 0.5f, (rect[1] + rect[3]) * 0.5f);
+    _offset = glm::vec2(_width, _height) * 0.5f - center * _zoom;
+}
@@ -0,0 +1,92 @@
+#include "DxfWriter.h"
+#include <set>
+#include <Entities/Line.h>
+#include <Entities/Circle.h>
+#include <Entities/Arc.h>
+#include <Entities/Polyline.h>
+
+DxfWriter::DxfWriter(const std::vector<std::shared_ptr<Entity>>& entities)
+	: _entities(entities)
+{
+}
+
+bool DxfWriter::write(const std::string& filename)
+{
+	_written = 0;
+	_skipped = 0;
+
+	dxfRW dxf(filename.c_str());
+	_dxf = &dxf;
+	bool ok = dxf.write(this, DRW::AC1015, false);
+	_dxf = nullptr;
+	return ok;
+}
+
+void DxfWriter::writeLayers()
+{
+	std::set<std::string> names;
+	for (const auto& entity : _entities) {
+		if (!entity->getLayer().empty())
+			names.insert(entity->getLayer());
+	}
+
+	for (const auto& name : names) {
+		DRW_Layer layer;
+		layer.name = name;
+		_dxf->writeLayer(&layer);
+	}
+}
+
+void DxfWriter::writeEntities()
+{
+	for (const auto& entity : _entities) {
+		const Entity* e = entity.get();
+
+		if (auto* poly = dynamic_cast<const Polyline*>(e)) {
+			DRW_LWPolyline data;
+			data.layer = poly->getLayer();
+			data.flags = poly->getIsClosed() ? 1 : 0;
+			for (const auto& v : poly->getPolyVertices()) {
+				DRW_Vertex2D vertex;
+				vertex.x = v.position.x;
+				vertex.y = v.position.y;
+				vertex.bulge = v.bulge;
+				data.addVertex(vertex);
+			}
+			_dxf->writeLWPolyline(&data);
+		}
+		else if (auto* arc = dynamic_cast<const Arc*>(e)) {
+			DRW_Arc data;
+			data.layer = arc->getLayer();
+			data.basePoint.x = arc->getCenterX();
+			data.basePoint.y = arc->getCenterY();
+			data.radious = arc->getRadius();
+			data.staangle = arc->getStartAngle();
+			data.endangle = arc->getStartAngle() + arc->getAngleRange();
+			_dxf->writeArc(&data);
+		}
+		else if (auto* circle = dynamic_cast<const Circle*>(e)) {
+			DRW_Circle data;
+			data.layer = circle->getLayer();
+			data.basePoint.x = circle->getCenterX();
+			data.basePoint.y = circle->getCenterY();
+			data.radious = circle->getRadius();
+			_dxf->writeCircle(&data);
+		}
+		else if (auto* line = dynamic_cast<const Line*>(e); line && line->getVertexCount() == 2) {
+			const auto& v = line->getVertices();
+			DRW_Line data;
+			data.layer = line->getLayer();
+			data.basePoint.x = v[0];
+			data.basePoint.y = v[1];
+			data.secPoint.x = v[2];
+			data.secPoint.y = v[3];
+			_dxf->writeLine(&data);
+		}
+		else {
+			++_skipped;
+			continue;
+		}
+		++_written;
+	}
+}
@@ -1,29 +1,264 @@
-#include "DxfLoader.h"
+#include "Dxfloader.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <Entities/Line.h>
 #include <Entities/Circle.h>
 #include <Entities/Arc.h>
 #include <Entities/Polyline.h>
+#include <Entities/Insert.h>
+#include <AutoDxfHelper.h>
+#include <MemoryStats.h>
+#include <Tessellator.h>
 
-DxfLoader::DxfLoader() {}
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <stdlib.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Thrown from a reader callback to unwind out of dxfRW::read when the
+// progress callback asks to cancel.
+struct LoadCancelled {};
+
+// Progress is reported every this many entity records.
+constexpr size_t kProgressInterval = 1024;
+
+using Clock = std::chrono::steady_clock;
+
+double MsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// libdxfrw opens the file itself and has no progress hook, so the load asks
+// the OS how far the descriptor it reads through has got. That runs ahead of
+// the parser by at most one stream buffer.
+
+// Size and identity (device and inode, or volume and file index) of a file
+bool IdentifyFile(const std::string& filename, std::uint64_t& size, std::uint64_t id[2])
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	BY_HANDLE_FILE_INFORMATION info;
+	const bool ok = GetFileInformationByHandle(file, &info) != 0;
+	CloseHandle(file);
+	if (!ok) return false;
+	size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+	id[0] = info.dwVolumeSerialNumber;
+	id[1] = (static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+	return true;
+#else
+	struct stat st;
+	if (::stat(filename.c_str(), &st) != 0) return false;
+	size = static_cast<std::uint64_t>(st.st_size);
+	id[0] = static_cast<std::uint64_t>(st.st_dev);
+	id[1] = static_cast<std::uint64_t>(st.st_ino);
+	return true;
+#endif
+}
+
+#ifdef _WIN32
+// _get_osfhandle reports unused descriptors through the invalid parameter handler
+void IgnoreInvalidParameter(const wchar_t*, const wchar_t*, const wchar_t*, unsigned, uintptr_t) {}
+#endif
+
+// Highest descriptor of this process open on the identified file, -1 if none.
+// The reader opened it last, so the highest one is the reader's.
+int FindDescriptor(const std::uint64_t id[2])
+{
+	constexpr int kMaxDescriptor = 4096;
+#ifdef _WIN32
+	auto previous = _set_thread_local_invalid_parameter_handler(IgnoreInvalidParameter);
+	int found = -1;
+	for (int fd = kMaxDescriptor - 1; fd > 2 && found < 0; --fd) {
+		HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+		BY_HANDLE_FILE_INFORMATION info;
+		if (file == INVALID_HANDLE_VALUE || !GetFileInformationByHandle(file, &info)) continue;
+		if (info.dwVolumeSerialNumber == id[0]
+			&& ((static_cast<std::uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow) == id[1])
+			found = fd;
+	}
+	_set_thread_local_invalid_parameter_handler(previous);
+	return found;
+#else
+	const int limit = static_cast<int>(std::min<long>(sysconf(_SC_OPEN_MAX), kMaxDescriptor));
+	for (int fd = limit - 1; fd > 2; --fd) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && static_cast<std::uint64_t>(st.st_dev) == id[0]
+			&& static_cast<std::uint64_t>(st.st_ino) == id[1])
+			return fd;
+	}
+	return -1;
+#endif
+}
+
+// Offset of a descriptor, which is left where it is
+std::uint64_t DescriptorOffset(int fd)
+{
+#ifdef _WIN32
+	const __int64 pos = _telli64(fd);
+#else
+	const off_t pos = lseek(fd, 0, SEEK_CUR);
+#endif
+	return pos < 0 ? 0 : static_cast<std::uint64_t>(pos);
+}
+
+} // namespace
+
+DxfLoader::DxfLoader()
+	: _chordTolerance(AutoDxfHelper::DEFAULT_CHORD_TOLERANCE)
+{
+}
+
+DxfLoader::~DxfLoader() = default;
+
+void DxfLoader::setTessellationThreads(unsigned threads)
+{
+	if (threads == _tessellationThreads) return;
+	_tessellationThreads = threads;
+	_tessellator.reset();
+}
 
 bool DxfLoader::load(const std::string& filename)
 {
+	_entities.clear();
+	_chunk.clear();
+	_pending.clear();
+	_blocks.clear();
+	_currentBlock.reset();
+	_blocksBuilt = false;
+	_report = DxfLoadReport{};
+	_entitiesRead = 0;
+	_cancelled = false;
+	_fileSize = 0;
+	_fileKnown = false;
+	_readerFd = -1;
+	_arena = std::make_shared<DocumentArena>();
+	_layers.clear();
+	// The tessellation workers count their own; their share is added at the end
+	const std::uint64_t allocationsBefore = MemoryStats::threadAllocationCount();
+	const std::uint64_t workerAllocationsBefore = _tessellator ? _tessellator->getWorkerAllocationCount() : 0;
+
+	if (_progress) {
+		_fileKnown = IdentifyFile(filename, _fileSize, _fileId);
+		if (!_progress(0, _fileSize)) {
+			_cancelled = true;
+			return false;
+		}
+	}
+
 	DRW_Interface* iface = this;
+	auto start = Clock::now();
 	dxfRW reader(filename.c_str());
-	if (!reader.read(iface, false)) {
-		std::cerr << "Failed to load DXF: " << filename << std::endl;
+	try {
+		if (!reader.read(iface, false)) {
+			std::cerr << "Failed to load DXF: " << filename << std::endl;
+			return false;
+		}
+	}
+	catch (const LoadCancelled&) {
+		_cancelled = true;
+		_entities.clear();
+		_chunk.clear();
+		_pending.clear();
 		return false;
 	}
+	flushChunk();
+	// The tessellation stage runs between callbacks, take it out of the parse time
+	_report.parseMs = MsSince(start) - _report.tessellateMs;
+
+	buildBlocks(); // blocks that were never inserted in model space
+
+	_report.allocationCount = MemoryStats::threadAllocationCount() - allocationsBefore;
+	if (_tessellator)
+		_report.allocationCount += _tessellator->getWorkerAllocationCount() - workerAllocationsBefore;
+	_report.arenaBytes = _arena->getBytesAllocated();
+	_report.peakRssBytes = MemoryStats::peakResidentBytes();
+
+	if (_progress) _progress(_fileSize, _fileSize);
 	return true;
 }
 
-void DxfLoader::addLine(const DRW_Line& data)
+void DxfLoader::skipEntity(const char* type)
+{
+	entityRead();
+	++_report.skippedByType[type];
+	++_report.skippedCount;
+}
+
+void DxfLoader::addEntity(const char* type, std::shared_ptr<Entity> entity, bool tessellate)
+{
+	++_report.entitiesByType[type];
+	++_report.entitiesByLayer[entity->getLayer()];
+	++_report.entityCount;
+	if (tessellate)
+		_pending.push_back(entity); // counted once the stage has run
+	else
+		_report.vertexCount += entity->getVertexCount();
+
+	if (_currentBlock) {
+		_currentBlock->addEntity(std::move(entity));
+		return;
+	}
+	if (_chunkCallback) {
+		_chunk.push_back(entity);
+		if (_chunk.size() >= _chunkSize) flushChunk();
+	}
+	_entities.push_back(std::move(entity));
+}
+
+void DxfLoader::tessellatePending()
+{
+	if (_pending.empty()) return;
+	auto start = Clock::now();
+	if (!_tessellator)
+		_tessellator = std::make_unique<Tessellator>(_tessellationThreads);
+	_report.vertexCount += _tessellator->run(_pending, _chordTolerance);
+	_report.tessellateMs += MsSince(start);
+	_pending.clear();
+}
+
+void DxfLoader::flushChunk()
 {
-	std::cout << "Line: (" << data.basePoint.x << "," << data.basePoint.y << ") -> ("
-		<< data.secPoint.x << "," << data.secPoint.y << ")\n";
+	// Entities are published with their vertices
+	tessellatePending();
+	if (_chunk.empty() || !_chunkCallback) return;
+	std::vector<std::shared_ptr<Entity>> chunk;
+	chunk.swap(_chunk);
+	_chunk.reserve(_chunkSize);
+	_chunkCallback(std::move(chunk));
+}
 
-	auto line = std::make_shared<Line>(
+void DxfLoader::entityRead()
+{
+	++_entitiesRead;
+	if (!_progress || _entitiesRead % kProgressInterval != 0)
+		return;
+
+	// The reader's descriptor is looked up once; without it only cancelling works
+	if (_fileKnown && _readerFd < 0) {
+		_readerFd = FindDescriptor(_fileId);
+		_fileKnown = _readerFd >= 0;
+	}
+	const std::uint64_t bytesRead = _fileKnown ? std::min(DescriptorOffset(_readerFd), _fileSize) : 0;
+	if (!_progress(bytesRead, _fileSize))
+		throw LoadCancelled{};
+}
+
+void DxfLoader::addLine(const DRW_Line& data)
+{
+	entityRead();
+	auto line = DocumentArena::make<Line>(_arena,
 		static_cast<float>(data.basePoint.x),
 		static_cast<float>(data.basePoint.y),
 		static_cast<float>(data.secPoint.x),
@@ -31,52 +266,144 @@ void DxfLoader::addLine(const DRW_Line& data)
 	);
 
 	line->setColor(1.0f, 0.0f, 0.0f);
-	line->setLayer(data.layer);
-	_entities.push_back(line);
+	line->setLayer(internLayer(data.layer));
+	addEntity("LINE", line);
 }
 
 void DxfLoader::addCircle(const DRW_Circle& data) 
 {
-	auto c = std::make_shared<Circle>(
-		static_cast<float>(data.basePoint.x),
-		static_cast<float>(data.basePoint.y),
-		static_cast<float>(data.radious)
-	);
+	entityRead();
+	float radius = static_cast<float>(data.radious);
+	float cx = static_cast<float>(data.basePoint.x);
+	float cy = static_cast<float>(data.basePoint.y);
+	auto c = DocumentArena::make<Circle>(_arena, cx, cy, radius, std::vector<float>());
+
 	c->setColor(0.0f,1.0f, 0.0f);
-	c->setLayer(data.layer);
-	_entities.push_back(c);
+	c->setLayer(internLayer(data.layer));
+	// The viewer draws circles analytically; only block geometry needs vertices
+	addEntity("CIRCLE", c, _currentBlock != nullptr);
 }
 
 void DxfLoader::addLWPolyline(const DRW_LWPolyline& data)
 {
-	std::cout << "lwply size:" << data.vertlist.size() << std::endl;
-
-	if (data.vertlist.empty())
+	if (data.vertlist.empty()) {
+		skipEntity("LWPOLYLINE");
 		return;
+	}
+
+	entityRead();
+	// Only the bulge vertices here, the tessellation stage fills in the rest
+	auto polyline = DocumentArena::make<Polyline>(_arena,
+		Polyline::VerticesOf(data), (data.flags & 1) != 0, std::vector<float>());
 
-	auto polyline = std::make_shared<Polyline>(data);
 	polyline->setColor(1.0f, 1.0f, 1.0f);
-	polyline->setLayer(data.layer);
-	_entities.push_back(polyline);
+	polyline->setLayer(internLayer(data.layer));
+	addEntity("LWPOLYLINE", polyline, true);
 }
 
 void DxfLoader::addArc(const DRW_Arc& data) 
 {
-	auto arc = std::make_shared<Arc>(
-		static_cast<float>(data.basePoint.x),
-		static_cast<float>(data.basePoint.y),
-		static_cast<float>(data.radious),
-		static_cast<float>(data.staangle),
-		static_cast<float>(data.endangle),
-		64
-	);
+	entityRead();
+	float radius = static_cast<float>(data.radious);
+	float startAngle = static_cast<float>(data.staangle);
+	float endAngle = static_cast<float>(data.endangle);
+	float cx = static_cast<float>(data.basePoint.x);
+	float cy = static_cast<float>(data.basePoint.y);
+	auto arc = DocumentArena::make<Arc>(_arena, cx, cy, radius, startAngle, endAngle, std::vector<float>());
 
 	arc->setColor(1.0f, 0.0f, 0.0f);
-	arc->setLayer(data.layer);
-	_entities.push_back(arc);
+	arc->setLayer(internLayer(data.layer));
+	// Drawn analytically like circles, outside blocks
+	addEntity("ARC", arc, _currentBlock != nullptr);
 }
 
 void DxfLoader::addPolyline(const DRW_Polyline& data)
 {
+	skipEntity("POLYLINE");
+}
+
+std::shared_ptr<const std::string> DxfLoader::internLayer(const std::string& name)
+{
+	return _layers.getSharedName(_layers.intern(name));
+}
+
+void DxfLoader::addLayer(const DRW_Layer& data)
+{
+	LayerInfo& layer = _layers.get(_layers.intern(data.name));
+	// A negative color number means the layer is off, flag 1 that it is frozen
+	LayerTable::AciToRgb(data.color, layer.color);
+	layer.visible = data.color >= 0;
+	layer.frozen = (data.flags & 1) != 0;
+}
+
+std::shared_ptr<BlockDefinition> DxfLoader::blockNamed(const std::string& name)
+{
+	auto& block = _blocks[name];
+	if (!block) block = std::make_shared<BlockDefinition>(name);
+	return block;
+}
+
+void DxfLoader::buildBlocks()
+{
+	// Block geometry is flattened from the vertices
+	tessellatePending();
 
-}
\ No newline at end of file
+	// Flatten every block once; all inserts share the result
+	auto start = Clock::now();
+	for (auto& [name, block] : _blocks) {
+		block->build();
+	}
+	_report.tessellateMs += MsSince(start);
+}
+
+void DxfLoader::addBlock(const DRW_Block& data)
+{
+	entityRead();
+	_currentBlock = blockNamed(data.name);
+	_currentBlock->setBasePoint(glm::vec2(
+		static_cast<float>(data.basePoint.x),
+		static_cast<float>(data.basePoint.y)));
+}
+
+void DxfLoader::endBlock()
+{
+	entityRead();
+	_currentBlock.reset();
+}
+
+void DxfLoader::addInsert(const DRW_Insert& data)
+{
+	entityRead();
+	auto block = blockNamed(data.name);
+
+	// Model space entities follow the BLOCKS section, so every definition is
+	// complete now. Build them here, on the loading thread, before any insert
+	// is published to the viewer.
+	if (!_currentBlock) {
+		if (!_blocksBuilt) {
+			buildBlocks();
+			_blocksBuilt = true;
+		}
+		if (!block->isBuilt()) block->build(); // undefined block, stays empty
+	}
+
+	glm::vec2 insertionPoint(static_cast<float>(data.basePoint.x), static_cast<float>(data.basePoint.y));
+	int columns = std::max(1, data.colcount);
+	int rows = std::max(1, data.rowcount);
+
+	// One Insert per array cell, all sharing the block geometry
+	for (int row = 0; row < rows; ++row) {
+		for (int col = 0; col < columns; ++col) {
+			glm::vec2 cellOffset(
+				static_cast<float>(col * data.colspace),
+				static_cast<float>(row * data.rowspace));
+			glm::mat3 transform = Insert::MakeTransform(insertionPoint,
+				static_cast<float>(data.xscale), static_cast<float>(data.yscale),
+				static_cast<float>(data.angle), cellOffset);
+
+			auto insert = DocumentArena::make<Insert>(_arena, block, transform);
+			insert->setLayer(internLayer(data.layer));
+			addEntity("INSERT", insert);
+		}
+	}
+}
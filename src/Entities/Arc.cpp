@@ -1,33 +1,77 @@
 #include "Entities/Arc.h"
 #include <cmath>
+#include "AutoDxfHelper.h"
+#include <glm/ext/scalar_constants.hpp>
 
 Arc::Arc(float cx, float cy, float radius,
     float startAngle, float endAngle,
     int segments)
+    : _cx(cx), _cy(cy), _radius(radius), _startAngle(startAngle)
 {
     // If end angle is less than start, wrap around
     if (endAngle < startAngle) {
-        endAngle += 2.0f * static_cast<float>(M_PI);
+        endAngle += 2.0f * glm::pi<float>();
     }
 
-    float angleRange = endAngle - startAngle;
+    _angleRange = endAngle - startAngle;
+    vertices = Tessellate(cx, cy, radius, startAngle, _angleRange, segments);
+}
+
+Arc::Arc(float cx, float cy, float radius,
+    float startAngle, float endAngle,
+    std::vector<float> tessellated)
+    : _cx(cx), _cy(cy), _radius(radius), _startAngle(startAngle)
+{
+    if (endAngle < startAngle) {
+        endAngle += 2.0f * glm::pi<float>();
+    }
+
+    _angleRange = endAngle - startAngle;
+    vertices = std::move(tessellated);
+}
+
+std::vector<float> Arc::Tessellate(float cx, float cy, float radius,
+    float startAngle, float angleRange, int segments)
+{
+    std::vector<float> out;
     float step = angleRange / static_cast<float>(segments);
 
-    vertices.reserve((segments + 1) * 2);
+    out.reserve((segments + 1) * 2);
     for (int i = 0; i <= segments; ++i) {
         float angle = startAngle + i * step;
         float x = cx + radius * std::cos(angle);
         float y = cy + radius * std::sin(angle);
-        vertices.push_back(x);
-        vertices.push_back(y);
+        out.push_back(x);
+        out.push_back(y);
     }
+    return out;
 }
 
-void Arc::draw(QOpenGLFunctions_3_3_Core* f) const
+bool Arc::hitTest(float worldX, float worldY, float tolerance) const
 {
-    if (_vAO == 0) return;
+    return AutoDxfHelper::DistanceToArc({ worldX, worldY }, { _cx, _cy }, _radius,
+        _startAngle, _angleRange) <= tolerance;
+}
+
+bool Arc::getBounds(float bounds[4]) const
+{
+    AutoDxfHelper::ArcBounds({ _cx, _cy }, _radius, _startAngle, _angleRange, bounds);
+    return true;
+}
 
-    f->glBindVertexArray(_vAO);
-    f->glDrawArrays(GL_LINE_STRIP, 0, static_cast<GLsizei>(vertices.size() / 2));
-    f->glBindVertexArray(0);
+bool Arc::getCircularArc(float& cx, float& cy, float& radius, float& startAngle, float& sweep) const
+{
+    cx = _cx;
+    cy = _cy;
+    radius = _radius;
+    startAngle = _startAngle;
+    sweep = _angleRange;
+    return true;
+}
+
+bool Arc::tessellate(float chordTolerance, std::vector<float>& out) const
+{
+    int segments = AutoDxfHelper::ArcSegments(_radius, _angleRange, chordTolerance);
+    out = Tessellate(_cx, _cy, _radius, _startAngle, _angleRange, segments);
+    return true;
 }
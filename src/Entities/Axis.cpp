@@ -53,3 +53,9 @@ void Axis::draw(QOpenGLFunctions_3_3_Core* f) const {
     f->glDrawArrays(GL_LINES, 0, vertices.size()/2);
     f->glBindVertexArray(0);
 }
+
+void Axis::deleteBuffers(QOpenGLFunctions_3_3_Core* f) {
+    if (_vBO) f->glDeleteBuffers(1, &_vBO);
+    if (_vAO) f->glDeleteVertexArrays(1, &_vAO);
+    _vAO = _vBO = 0;
+}
@@ -0,0 +1,70 @@
+#include "Entities/Block.h"
+#include "Entities/Insert.h"
+#include <algorithm>
+#include <limits>
+
+void BlockDefinition::build()
+{
+    if (_built || _building) return;
+    _building = true;
+
+    for (const auto& entity : _entities) {
+        // Nested insert: bake the child block's geometry in, transformed.
+        // Only definitions are flattened, references stay instanced.
+        if (const auto* insert = dynamic_cast<const Insert*>(entity.get())) {
+            BlockDefinition& child = *insert->getBlock();
+            child.build();
+            const glm::mat3& m = insert->getTransform();
+            for (const auto& range : child.getRanges()) {
+                DrawRange r = range;
+                r.first = static_cast<std::int32_t>(_vertices.size() / 2);
+                for (std::int32_t i = 0; i < range.count; ++i) {
+                    size_t idx = static_cast<size_t>(range.first + i) * 2;
+                    glm::vec3 p = m * glm::vec3(child._vertices[idx], child._vertices[idx + 1], 1.0f);
+                    _vertices.push_back(p.x - _basePoint.x);
+                    _vertices.push_back(p.y - _basePoint.y);
+                }
+                _ranges.push_back(r);
+            }
+            continue;
+        }
+
+        const auto& verts = entity->getVertices();
+        if (verts.empty()) continue;
+
+        DrawRange r;
+        r.first = static_cast<std::int32_t>(_vertices.size() / 2);
+        r.count = static_cast<std::int32_t>(verts.size() / 2);
+        r.mode = entity->getDrawMode();
+        const float* color = entity->getColor();
+        r.color[0] = color[0];
+        r.color[1] = color[1];
+        r.color[2] = color[2];
+        for (size_t i = 0; i + 1 < verts.size(); i += 2) {
+            _vertices.push_back(verts[i] - _basePoint.x);
+            _vertices.push_back(verts[i + 1] - _basePoint.y);
+        }
+        _ranges.push_back(r);
+    }
+
+    _bounds[0] = _bounds[1] = std::numeric_limits<float>::max();
+    _bounds[2] = _bounds[3] = std::numeric_limits<float>::lowest();
+    for (size_t i = 0; i + 1 < _vertices.size(); i += 2) {
+        _bounds[0] = std::min(_bounds[0], _vertices[i]);
+        _bounds[1] = std::min(_bounds[1], _vertices[i + 1]);
+        _bounds[2] = std::max(_bounds[2], _vertices[i]);
+        _bounds[3] = std::max(_bounds[3], _vertices[i + 1]);
+    }
+
+    _building = false;
+    _built = true;
+}
+
+void BlockDefinition::invalidate()
+{
+    _built = false;
+    _vertices.clear();
+    _ranges.clear();
+    _bounds[0] = _bounds[1] = 0.0f;
+    _bounds[2] = _bounds[3] = -1.0f;
+}
@@ -1,12 +1,27 @@
 #include "Entities/Circle.h"
 #include <cmath>
 #include <iostream>
+#include "AutoDxfHelper.h"
+#include <glm/ext/scalar_constants.hpp>
 
 Circle::Circle(float cx, float cy, float radius, int segments)
+    : _cx(cx), _cy(cy), _radius(radius)
 {
-    vertices.reserve(segments * 2);
+    vertices = Tessellate(cx, cy, radius, segments);
+}
+
+Circle::Circle(float cx, float cy, float radius, std::vector<float> tessellated)
+    : _cx(cx), _cy(cy), _radius(radius)
+{
+    vertices = std::move(tessellated);
+}
 
-    const float step = 2.0f * static_cast<float>(M_PI) / segments;
+std::vector<float> Circle::Tessellate(float cx, float cy, float radius, int segments)
+{
+    std::vector<float> out;
+    out.reserve(segments * 2);
+
+    const float step = 2.0f * glm::pi<float>() / segments;
 
     for (int i = 0; i < segments; ++i)
     {
@@ -14,20 +29,38 @@ Circle::Circle(float cx, float cy, float radius, int segments)
         float x = cx + radius * std::cos(angle);
         float y = cy + radius * std::sin(angle);
 
-        vertices.push_back(x);
-        vertices.push_back(y);
+        out.push_back(x);
+        out.push_back(y);
     }
+    return out;
 }
 
-void Circle::draw(QOpenGLFunctions_3_3_Core* f) const
+bool Circle::hitTest(float worldX, float worldY, float tolerance) const
 {
-    if (_vAO == 0)
-    {
-        std::cerr << "Circle::draw(): VAO not created\n";
-        return;
-    }
+    return AutoDxfHelper::DistanceToArc({ worldX, worldY }, { _cx, _cy }, _radius,
+        0.0f, 2.0f * glm::pi<float>()) <= tolerance;
+}
+
+bool Circle::getBounds(float bounds[4]) const
+{
+    AutoDxfHelper::ArcBounds({ _cx, _cy }, _radius, 0.0f, 2.0f * glm::pi<float>(), bounds);
+    return true;
+}
 
-    f->glBindVertexArray(_vAO);
-    f->glDrawArrays(GL_LINE_LOOP, 0, static_cast<GLsizei>(vertices.size() / 2));
-    f->glBindVertexArray(0);
+bool Circle::getCircularArc(float& cx, float& cy, float& radius, float& startAngle, float& sweep) const
+{
+    cx = _cx;
+    cy = _cy;
+    radius = _radius;
+    startAngle = 0.0f;
+    sweep = 2.0f * glm::pi<float>();
+    return true;
+}
+
+bool Circle::tessellate(float chordTolerance, std::vector<float>& out) const
+{
+    // A closed loop needs a few segments even for tiny holes
+    int segments = AutoDxfHelper::ArcSegments(_radius, 2.0f * glm::pi<float>(), chordTolerance, 8);
+    out = Tessellate(_cx, _cy, _radius, segments);
+    return true;
 }
@@ -1,49 +1,40 @@
 #include "Entities/Entity.h"
+#include <algorithm>
+#include <cmath>
 
 // Base class constructor
 Entity::Entity() = default;
 
-void Entity::createBuffers(QOpenGLFunctions_3_3_Core* f)
+const std::string& Entity::getLayer() const
 {
-    if (!f) return;
-
-    // Generate VAO/VBO
-    f->glGenVertexArrays(1, &_vAO);
-    f->glGenBuffers(1, &_vBO);
-
-    // Bind VAO, then VBO, upload, and set attribute
-    f->glBindVertexArray(_vAO);
-
-    f->glBindBuffer(GL_ARRAY_BUFFER, _vBO);
-    f->glBufferData(GL_ARRAY_BUFFER,
-        vertices.size() * sizeof(float),
-        vertices.data(),
-        GL_STATIC_DRAW);
-
-    // Attribute 0: 2 floats per vertex (x,y)  
-    f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE,
-        2 * sizeof(float),
-        reinterpret_cast<void*>(0));
-    f->glEnableVertexAttribArray(0);
+    static const std::string noLayer;
+    return _layer ? *_layer : noLayer;
+}
 
-    // Unbind for safety
-    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
-    f->glBindVertexArray(0);
+const std::vector<Entity::LodLevel>& Entity::getLodLevels() const
+{
+    static const std::vector<LodLevel> none;
+    return none;
 }
 
-// Delete VAO + VBO
-void Entity::deleteBuffers(QOpenGLFunctions_3_3_Core* f)
+bool Entity::getBounds(float bounds[4]) const
 {
-    if (!f) return;
+    return BoundsOf(vertices, bounds);
+}
 
-    if (_vBO != 0) {
-        f->glDeleteBuffers(1, &_vBO);
-        _vBO = 0;
-    }
-    if (_vAO != 0) {
-        f->glDeleteVertexArrays(1, &_vAO);
-        _vAO = 0;
+bool Entity::BoundsOf(const std::vector<float>& verts, float bounds[4])
+{
+    if (verts.size() < 2) return false;
+
+    bounds[0] = bounds[2] = verts[0];
+    bounds[1] = bounds[3] = verts[1];
+    for (size_t i = 2; i + 1 < verts.size(); i += 2) {
+        bounds[0] = std::min(bounds[0], verts[i]);
+        bounds[1] = std::min(bounds[1], verts[i + 1]);
+        bounds[2] = std::max(bounds[2], verts[i]);
+        bounds[3] = std::max(bounds[3], verts[i + 1]);
     }
+    return true;
 }
 
 bool Entity::hitTest(float worldX, float worldY, float tolerance) const
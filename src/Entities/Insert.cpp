@@ -0,0 +1,144 @@
+#include "Entities/Insert.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+float SegmentDistance(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b)
+{
+    glm::vec2 d = b - a;
+    float lenSq = glm::dot(d, d);
+    float t = (lenSq > 0) ? std::clamp(glm::dot(p - a, d) / lenSq, 0.f, 1.f) : 0.f;
+    return glm::distance(p, a + t * d);
+}
+
+// Walks the segments of one draw range the way OpenGL would connect them
+bool RangeHit(const float* v, std::int32_t count, Entity::DrawMode mode, const glm::vec2& p, float tolerance)
+{
+    auto vert = [v](std::int32_t i) { return glm::vec2(v[i * 2], v[i * 2 + 1]); };
+
+    if (mode == Entity::DrawMode::Lines) {
+        for (std::int32_t i = 0; i + 1 < count; i += 2) {
+            if (SegmentDistance(p, vert(i), vert(i + 1)) <= tolerance) return true;
+        }
+        return false;
+    }
+    for (std::int32_t i = 0; i + 1 < count; ++i) {
+        if (SegmentDistance(p, vert(i), vert(i + 1)) <= tolerance) return true;
+    }
+    if (mode == Entity::DrawMode::LineLoop && count > 2) {
+        return SegmentDistance(p, vert(count - 1), vert(0)) <= tolerance;
+    }
+    return false;
+}
+
+void CollectPolylines(const BlockDefinition& block, const glm::mat3& transform,
+    const std::string& insertLayer, int depth, std::vector<std::shared_ptr<Polyline>>& out)
+{
+    if (depth > 32) return; // self-referencing blocks
+
+    // A mirrored transform reverses the arc direction
+    float det = transform[0][0] * transform[1][1] - transform[1][0] * transform[0][1];
+    float bulgeSign = det < 0.0f ? -1.0f : 1.0f;
+
+    for (const auto& entity : block.getEntities()) {
+        const std::string& layer = entity->getLayer() == "0" ? insertLayer : entity->getLayer();
+
+        // Nested insert: child block coordinates go through the insert transform,
+        // then relative to this block's base point, the same as BlockDefinition::build()
+        if (const auto* insert = dynamic_cast<const Insert*>(entity.get())) {
+            glm::mat3 toBase(1.0f);
+            toBase[2] = glm::vec3(-block.getBasePoint(), 1.0f);
+            CollectPolylines(*insert->getBlock(), transform * toBase * insert->getTransform(), layer, depth + 1, out);
+            continue;
+        }
+
+        const auto* poly = dynamic_cast<const Polyline*>(entity.get());
+        if (!poly) continue;
+
+        std::vector<PolylineVertex> verts;
+        verts.reserve(poly->getPolyVertices().size());
+        for (const auto& v : poly->getPolyVertices()) {
+            glm::vec3 p = transform * glm::vec3(v.position - block.getBasePoint(), 1.0f);
+            verts.emplace_back(p.x, p.y, v.bulge * bulgeSign);
+        }
+        auto world = std::make_shared<Polyline>(verts, poly->getIsClosed());
+        world->setColor(poly->getColor()[0], poly->getColor()[1], poly->getColor()[2]);
+        world->setLayer(layer);
+        out.push_back(world);
+    }
+}
+
+} // namespace
+
+Insert::Insert(std::shared_ptr<BlockDefinition> block, const glm::mat3& transform)
+    : _block(std::move(block)), _transform(transform), _inverse(glm::inverse(transform))
+{
+}
+
+glm::mat3 Insert::MakeTransform(const glm::vec2& insertionPoint,
+    float xScale, float yScale, float rotation, const glm::vec2& cellOffset)
+{
+    auto translate = [](const glm::vec2& t) {
+        glm::mat3 m(1.0f);
+        m[2] = glm::vec3(t, 1.0f);
+        return m;
+    };
+
+    glm::mat3 rotate(1.0f);
+    float c = std::cos(rotation), s = std::sin(rotation);
+    rotate[0] = glm::vec3(c, s, 0.0f);
+    rotate[1] = glm::vec3(-s, c, 0.0f);
+
+    glm::mat3 scale(1.0f);
+    scale[0][0] = xScale;
+    scale[1][1] = yScale;
+
+    // Array cells are offset along the rotated insert axes
+    return translate(insertionPoint) * rotate * translate(cellOffset) * scale;
+}
+
+bool Insert::hitTest(float worldX, float worldY, float tolerance) const
+{
+    if (!_block || !_block->isBuilt()) return false;
+
+    // Test in block coordinates; scale the tolerance by the smaller axis scale
+    glm::vec3 local = _inverse * glm::vec3(worldX, worldY, 1.0f);
+    float axisScale = std::min(glm::length(glm::vec2(_transform[0])), glm::length(glm::vec2(_transform[1])));
+    if (axisScale <= 0.0f) return false;
+    float localTolerance = tolerance / axisScale;
+
+    const float* verts = _block->getVertices().data();
+    for (const auto& range : _block->getRanges()) {
+        if (RangeHit(verts + range.first * 2, range.count, range.mode, glm::vec2(local), localTolerance))
+            return true;
+    }
+    return false;
+}
+
+bool Insert::getBounds(float bounds[4]) const
+{
+    if (!_block || !_block->isBuilt()) return false;
+    const float* local = _block->getBounds();
+    if (local[0] > local[2]) return false;
+
+    // Box around the transformed corners of the block box
+    bounds[0] = bounds[1] = std::numeric_limits<float>::max();
+    bounds[2] = bounds[3] = std::numeric_limits<float>::lowest();
+    for (int corner = 0; corner < 4; ++corner) {
+        glm::vec3 p = _transform * glm::vec3(local[(corner & 1) ? 2 : 0], local[(corner & 2) ? 3 : 1], 1.0f);
+        bounds[0] = std::min(bounds[0], p.x);
+        bounds[1] = std::min(bounds[1], p.y);
+        bounds[2] = std::max(bounds[2], p.x);
+        bounds[3] = std::max(bounds[3], p.y);
+    }
+    return true;
+}
+
+std::vector<std::shared_ptr<Polyline>> Insert::getWorldPolylines() const
+{
+    std::vector<std::shared_ptr<Polyline>> result;
+    if (_block) CollectPolylines(*_block, _transform, getLayer(), 0, result);
+    return result;
+}
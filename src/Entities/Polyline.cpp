@@ -1,126 +1,264 @@
 #include "Entities/Polyline.h"
 #include "AutoDxfHelper.h"
+#include <algorithm>
+#include <cmath>
 #include <glm/ext/scalar_constants.hpp>
+
+namespace {
+
+// Arc a bulged segment from p1 to p2 sweeps; the sweep is signed like the bulge
+struct BulgeArc {
+	glm::vec2 center;
+	float radius;
+	float angle1;
+	float sweep;
+};
+
+BulgeArc ArcOf(const glm::vec2& p1, const glm::vec2& p2, float bulge)
+{
+	BulgeArc arc;
+	arc.center = AutoDxfHelper::CenterFromBulge(p1, p2, bulge);
+
+	arc.angle1 = std::atan2(p1.y - arc.center.y, p1.x - arc.center.x);
+	float angle2 = std::atan2(p2.y - arc.center.y, p2.x - arc.center.x);
+
+	// Ensure correct direction
+	if (bulge < 0.0f && angle2 > arc.angle1) angle2 -= 2.0f * glm::pi<float>();
+	if (bulge > 0.0f && angle2 < arc.angle1) angle2 += 2.0f * glm::pi<float>();
+
+	arc.sweep = angle2 - arc.angle1;
+	arc.radius = glm::distance(arc.center, p1);
+	return arc;
+}
+
+constexpr size_t kNoNext = static_cast<size_t>(-1);
+
+// Index of the vertex segment i ends at, considering closure; kNoNext for the
+// last vertex of an open polyline
+size_t NextIndex(size_t i, size_t vertCount, bool closed)
+{
+	if (i + 1 < vertCount) return i + 1;
+	return closed && vertCount > 1 ? 0 : kNoNext;
+}
+
+// Calls emit(x, y) for every vertex source vertices [begin, end) expand to
+template <typename Emit>
+void EmitRange(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance,
+	size_t begin, size_t end, Emit&& emit)
+{
+	for (size_t i = begin; i < end; ++i) {
+		const auto& v1 = plyvertices[i];
+		emit(v1.position.x, v1.position.y);
+
+		// If bulge is non-zero and there is a next vertex, interpolate arc
+		size_t nextIdx = NextIndex(i, plyvertices.size(), closed);
+		if (AutoDxfHelper::IsZero(v1.bulge) || nextIdx == kNoNext) continue;
+
+		BulgeArc arc = ArcOf(v1.position, plyvertices[nextIdx].position, v1.bulge);
+		// Number of segments for arc approximation
+		const int arcSegments = AutoDxfHelper::ArcSegments(arc.radius, arc.sweep, chordTolerance);
+		for (int s = 1; s < arcSegments; ++s) {
+			float t = static_cast<float>(s) / arcSegments;
+			float theta = arc.angle1 + t * arc.sweep;
+			emit(arc.center.x + arc.radius * std::cos(theta), arc.center.y + arc.radius * std::sin(theta));
+		}
+	}
+}
+
+}
+
 Polyline::Polyline(const DRW_LWPolyline& plydata)
+	: Polyline(plydata, AutoDxfHelper::DEFAULT_CHORD_TOLERANCE)
+{
+}
+
+Polyline::Polyline(const DRW_LWPolyline& plydata, float chordTolerance)
+	: m_plyvertices(VerticesOf(plydata))
+{
+	isClosed = (plydata.flags & 1) != 0; // check if closed flag is set: 1 for closed polyline
+
+	vertices = Tessellate(m_plyvertices, isClosed, chordTolerance);
+	m_lodLevels = makeLodLevels(vertices);
+}
+
+Polyline::Polyline(const std::vector<PolylineVertex>& verts, bool closed)
+	: Polyline(verts, closed, AutoDxfHelper::DEFAULT_CHORD_TOLERANCE)
+{
+}
+
+Polyline::Polyline(const std::vector<PolylineVertex>& verts, bool closed, float chordTolerance)
+{
+	m_plyvertices = verts;
+	isClosed = closed;
+
+	vertices = Tessellate(m_plyvertices, isClosed, chordTolerance);
+	m_lodLevels = makeLodLevels(vertices);
+}
+
+std::vector<PolylineVertex> Polyline::VerticesOf(const DRW_LWPolyline& plydata)
 {
 	// store vertices with bulge information
+	std::vector<PolylineVertex> verts;
+	verts.reserve(plydata.vertlist.size());
 	for (const auto& vertPtr : plydata.vertlist) {
 		if (vertPtr) {
-            m_plyvertices.emplace_back(
-                static_cast<float>(vertPtr->x),
-                static_cast<float>(vertPtr->y),
-                static_cast<float>(vertPtr->bulge)
-            );
+			verts.emplace_back(
+				static_cast<float>(vertPtr->x),
+				static_cast<float>(vertPtr->y),
+				static_cast<float>(vertPtr->bulge)
+			);
 		}
 	}
+	return verts;
+}
 
-	isClosed = (plydata.flags & 1) != 0; // check if closed flag is set: 1 for closed polyline
+std::vector<float> Polyline::Tessellate(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance)
+{
+	std::vector<float> out;
+	out.reserve(plyvertices.size() * 2);
 
 	// Populate the base class vertices for OpenGL, handling bulge (arc) if present
-	size_t vertCount = m_plyvertices.size();
-	for (size_t i = 0; i < vertCount; ++i) {
-		const auto& v1 = m_plyvertices[i];
-		vertices.push_back(v1.position.x);
-		vertices.push_back(v1.position.y);
-
-		// Determine the next vertex index, considering closure
-		size_t nextIdx = i + 1;
-		bool hasNext = nextIdx < vertCount;
-		if (!hasNext && isClosed && vertCount > 1) {
-			nextIdx = 0;
-			hasNext = true;
-		}
+	EmitRange(plyvertices, closed, chordTolerance, 0, plyvertices.size(), [&out](float x, float y) {
+		out.push_back(x);
+		out.push_back(y);
+	});
+	return out;
+}
 
-		// If bulge is non-zero and there is a next vertex, interpolate arc
-		if (!AutoDxfHelper::IsZero(v1.bulge) && hasNext) {
-			const auto& v2 = m_plyvertices[nextIdx];
-			// Calculate arc points between v1 and v2 using bulge
-			const int arcSegments = 16; // Number of segments for arc approximation
-			glm::vec2 p1 = v1.position;
-			glm::vec2 p2 = v2.position;
-			double bulge = v1.bulge;
-
-			// Center of the arc
-			glm::vec2 center = AutoDxfHelper::CenterFromBulge(p1, p2, bulge);
-
-			// Angles
-			float angle1 = std::atan2(p1.y - center.y, p1.x - center.x);
-			float angle2 = std::atan2(p2.y - center.y, p2.x - center.x);
-
-			// Ensure correct direction
-			if (bulge < 0.0f && angle2 > angle1) angle2 -= 2.0f * glm::pi<float>();
-			if (bulge > 0.0f && angle2 < angle1) angle2 += 2.0f * glm::pi<float>();
-
-			float radius = glm::distance(center, p1);
-			for (int s = 1; s < arcSegments; ++s) {
-				float t = static_cast<float>(s) / arcSegments;
-				float theta = angle1 + t * (angle2 - angle1);
-				float x = center.x + radius * std::cos(theta);
-				float y = center.y + radius * std::sin(theta);
-				vertices.push_back(x);
-				vertices.push_back(y);
-			}
+void Polyline::CountTessellated(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance,
+	size_t begin, size_t end, std::uint32_t* counts)
+{
+	for (size_t i = begin; i < end; ++i) {
+		const auto& v1 = plyvertices[i];
+		size_t nextIdx = NextIndex(i, plyvertices.size(), closed);
+		if (AutoDxfHelper::IsZero(v1.bulge) || nextIdx == kNoNext) {
+			counts[i - begin] = 1;
+			continue;
 		}
+		BulgeArc arc = ArcOf(v1.position, plyvertices[nextIdx].position, v1.bulge);
+		counts[i - begin] = static_cast<std::uint32_t>(std::max(1, AutoDxfHelper::ArcSegments(arc.radius, arc.sweep, chordTolerance)));
 	}
 }
 
-Polyline::Polyline(const std::vector<PolylineVertex>& verts, bool closed)
+void Polyline::TessellateRange(const std::vector<PolylineVertex>& plyvertices, bool closed, float chordTolerance,
+	size_t begin, size_t end, float* out)
 {
-	m_plyvertices = verts;
-	isClosed = closed;
+	EmitRange(plyvertices, closed, chordTolerance, begin, end, [&out](float x, float y) {
+		*out++ = x;
+		*out++ = y;
+	});
+}
 
-	size_t vertCount = m_plyvertices.size();
-	for (size_t i = 0; i < vertCount; ++i) {
-		const auto& v1 = m_plyvertices[i];
-		vertices.push_back(v1.position.x);
-		vertices.push_back(v1.position.y);
-
-		size_t nextIdx = i + 1;
-		bool hasNext = nextIdx < vertCount;
-		if (!hasNext && isClosed && vertCount > 1) {
-			nextIdx = 0;
-			hasNext = true;
-		}
+bool Polyline::tessellate(float chordTolerance, std::vector<float>& out) const
+{
+	bool hasArc = std::any_of(m_plyvertices.begin(), m_plyvertices.end(),
+		[](const PolylineVertex& v) { return !AutoDxfHelper::IsZero(v.bulge); });
+	if (!hasArc) return false;
 
-		if (!AutoDxfHelper::IsZero(v1.bulge) && hasNext) {
-			const auto& v2 = m_plyvertices[nextIdx];
-			const int arcSegments = 16;
-			glm::vec2 p1 = v1.position;
-			glm::vec2 p2 = v2.position;
-			float bulge = v1.bulge;
-
-			glm::vec2 center = AutoDxfHelper::CenterFromBulge(p1, p2, bulge);
-
-			float angle1 = std::atan2(p1.y - center.y, p1.x - center.x);
-			float angle2 = std::atan2(p2.y - center.y, p2.x - center.x);
-
-			if (bulge < 0.0f && angle2 > angle1) angle2 -= 2.0f * glm::pi<float>();
-			if (bulge > 0.0f && angle2 < angle1) angle2 += 2.0f * glm::pi<float>();
-
-			float radius = glm::distance(center, p1);
-			for (int s = 1; s < arcSegments; ++s) {
-				float t = static_cast<float>(s) / arcSegments;
-				float theta = angle1 + t * (angle2 - angle1);
-				float x = center.x + radius * std::cos(theta);
-				float y = center.y + radius * std::sin(theta);
-				vertices.push_back(x);
-				vertices.push_back(y);
-			}
-		}
+	out = Tessellate(m_plyvertices, isClosed, chordTolerance);
+	return true;
+}
+
+Polyline::Polyline(std::vector<PolylineVertex> verts, bool closed, std::vector<float> tessellated)
+	: m_plyvertices(std::move(verts)), isClosed(closed)
+{
+	vertices = std::move(tessellated);
+	m_lodLevels = makeLodLevels(vertices);
+}
+
+size_t Polyline::getSegmentCount() const
+{
+	if (m_plyvertices.size() < 2) return 0;
+	return isClosed ? m_plyvertices.size() : m_plyvertices.size() - 1;
+}
+
+std::shared_ptr<const Polyline::SegmentIndex> Polyline::getSegmentIndex() const
+{
+	if (auto index = std::atomic_load(&m_segmentIndex))
+		return index;
+
+	auto index = std::make_shared<SegmentIndex>();
+	const size_t segCount = getSegmentCount();
+	index->bounds.resize(segCount * 4);
+	for (size_t i = 0; i < segCount; ++i) {
+		const auto& v = m_plyvertices[i];
+		AutoDxfHelper::PolylineSegment seg{ v.position, m_plyvertices[(i + 1) % m_plyvertices.size()].position,
+			v.bulge, static_cast<int>(i) };
+		AutoDxfHelper::SegmentBounds(seg, &index->bounds[i * 4]);
 	}
+	index->tree.build(index->bounds);
+
+	std::shared_ptr<const SegmentIndex> built = std::move(index);
+	std::atomic_store(&m_segmentIndex, built);
+	return built;
+}
+
+float Polyline::distanceTo(float x, float y, float maxDistance) const
+{
+	const glm::vec2 p(x, y);
+	auto segmentDistance = [&](std::uint32_t i) {
+		const glm::vec2& p1 = m_plyvertices[i].position;
+		const glm::vec2& p2 = m_plyvertices[(i + 1) % m_plyvertices.size()].position;
+		float d;
+		if (AutoDxfHelper::IsZero(m_plyvertices[i].bulge)) {
+			glm::vec2 dir = p2 - p1;
+			float lengthSq = glm::dot(dir, dir);
+			float t = lengthSq > 0.0f ? std::clamp(glm::dot(p - p1, dir) / lengthSq, 0.0f, 1.0f) : 0.0f;
+			d = glm::distance(p, p1 + t * dir);
+		}
+		else {
+			// Counter-clockwise from the start angle, whichever way the bulge runs
+			BulgeArc arc = ArcOf(p1, p2, m_plyvertices[i].bulge);
+			float start = arc.sweep < 0.0f ? arc.angle1 + arc.sweep : arc.angle1;
+			d = AutoDxfHelper::DistanceToArc(p, arc.center, arc.radius, start, std::abs(arc.sweep));
+		}
+		return std::isfinite(d) ? d : -1.0f;
+	};
+
+	std::uint32_t nearest = getSegmentIndex()->tree.nearest(x, y, maxDistance, segmentDistance);
+	return nearest != RTree::INVALID_ID ? segmentDistance(nearest) : -1.0f;
 }
 
-void Polyline::draw(QOpenGLFunctions_3_3_Core* f) const
+std::vector<Entity::LodLevel> Polyline::makeLodLevels(const std::vector<float>& verts) const
 {
-	if (vertices.empty() || !_vAO || !_vBO) return;
+	std::vector<LodLevel> levels;
+	const size_t count = verts.size() / 2;
+	float bounds[4];
+	if (count < kMinLodVertices || !BoundsOf(verts, bounds)) return levels;
 
-	f->glBindVertexArray(_vAO);
-	f->glBindBuffer(GL_ARRAY_BUFFER, _vBO);
+	std::vector<float> rank;
+	AutoDxfHelper::DouglasPeuckerRanks(verts, rank);
+
+	// Tolerances halve from half the extent; a level is worth keeping only if it
+	// at most halves the vertices of the next finer one, so the pyramid costs
+	// less memory than the outline itself
+	std::vector<std::pair<float, size_t>> candidates;
+	float tolerance = std::max(bounds[2] - bounds[0], bounds[3] - bounds[1]) * 0.5f;
+	for (int step = 0; step < 32 && tolerance > 0.0f; ++step, tolerance *= 0.5f) {
+		size_t kept = std::count_if(rank.begin(), rank.end(), [tolerance](float r) { return r > tolerance; });
+		if (kept * 4 > count * 3) break; // hardly simpler than the full outline
+		candidates.emplace_back(tolerance, kept);
+	}
 
-	// Draw as line strip or loop depending on isClosed
-	GLenum mode = isClosed ? GL_LINE_LOOP : GL_LINE_STRIP;
-	f->glDrawArrays(mode, 0, static_cast<GLsizei>(vertices.size() / 2));
+	size_t finer = count;
+	std::vector<std::pair<float, size_t>> chosen;
+	for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+		if (it->second * 2 > finer) continue;
+		chosen.push_back(*it);
+		finer = it->second;
+	}
 
-	f->glBindBuffer(GL_ARRAY_BUFFER, 0);
-	f->glBindVertexArray(0);
-}
\ No newline at end of file
+	// Coarsest first
+	for (auto it = chosen.rbegin(); it != chosen.rend(); ++it) {
+		LodLevel level{ it->first, {} };
+		level.vertices.reserve(it->second * 2);
+		for (size_t i = 0; i < count; ++i) {
+			if (rank[i] > it->first) {
+				level.vertices.push_back(verts[i * 2]);
+				level.vertices.push_back(verts[i * 2 + 1]);
+			}
+		}
+		levels.push_back(std::move(level));
+	}
+	return levels;
+}
@@ -0,0 +1,106 @@
+#include "FrameStats.h"
+#include <algorithm>
+
+namespace {
+
+// Nearest-rank percentile; sorts the values in place
+double Percentile(std::vector<double>& values, double p)
+{
+    if (values.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+template <typename T>
+void PushRing(std::vector<T>& ring, size_t& next, const T& value)
+{
+    if (ring.size() < FrameStats::kWindow) {
+        ring.push_back(value);
+        return;
+    }
+    ring[next] = value;
+    next = (next + 1) % FrameStats::kWindow;
+}
+
+}
+
+double FrameStats::ElapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+void FrameStats::beginFrame()
+{
+    auto now = std::chrono::steady_clock::now();
+    _current = Sample{};
+    if (_hasPreviousFrame) {
+        double interval = std::chrono::duration<double, std::milli>(now - _frameStart).count();
+        if (interval <= kIdleGapMs) _current.intervalMs = interval;
+    }
+    _frameStart = now;
+    _hasPreviousFrame = true;
+}
+
+void FrameStats::endFrame()
+{
+    // Submission is whatever the measured phases leave of the frame
+    double total = ElapsedMs(_frameStart);
+    double measured = 0.0;
+    for (int phase = 0; phase < PhaseCount; ++phase)
+        if (phase != Submit) measured += _current.cpuMs[phase];
+    _current.cpuMs[Submit] = std::max(0.0, total - measured);
+    PushRing(_samples, _nextSample, _current);
+}
+
+void FrameStats::addGpuTime(double ms)
+{
+    PushRing(_gpuMs, _nextGpu, ms);
+}
+
+void FrameStats::clear()
+{
+    _samples.clear();
+    _gpuMs.clear();
+    _nextSample = _nextGpu = 0;
+    _hasPreviousFrame = false;
+}
+
+FrameStats::Summary FrameStats::summarize() const
+{
+    Summary summary;
+    summary.frames = _samples.size();
+    if (_samples.empty()) return summary;
+
+    std::vector<double> intervals;
+    intervals.reserve(_samples.size());
+    double drawCalls = 0.0, vertices = 0.0;
+    for (const Sample& s : _samples) {
+        if (s.intervalMs > 0.0) intervals.push_back(s.intervalMs);
+        for (int phase = 0; phase < PhaseCount; ++phase)
+            summary.cpuMs[phase] += s.cpuMs[phase];
+        drawCalls += s.drawCalls;
+        vertices += static_cast<double>(s.vertices);
+    }
+    const double n = static_cast<double>(_samples.size());
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        summary.cpuMs[phase] /= n;
+        summary.cpuTotalMs += summary.cpuMs[phase];
+    }
+    summary.drawCalls = drawCalls / n;
+    summary.vertices = vertices / n;
+
+    if (!intervals.empty()) {
+        double sum = 0.0;
+        for (double ms : intervals) sum += ms;
+        summary.fps = 1000.0 * intervals.size() / sum;
+        summary.frameP50Ms = Percentile(intervals, 0.5);
+        summary.frameP99Ms = Percentile(intervals, 0.99);
+    }
+    if (!_gpuMs.empty()) {
+        std::vector<double> gpu = _gpuMs;
+        summary.gpuP50Ms = Percentile(gpu, 0.5);
+        summary.gpuP99Ms = Percentile(gpu, 0.99);
+    }
+    return summary;
+}
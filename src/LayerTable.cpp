@@ -0,0 +1,57 @@
+#include "LayerTable.h"
+
+LayerTable::LayerId LayerTable::intern(const std::string& name)
+{
+    auto [it, inserted] = _index.emplace(name, static_cast<LayerId>(_layers.size()));
+    if (inserted) {
+        LayerInfo info;
+        info.name = name;
+        _layers.push_back(std::move(info));
+        _names.push_back(std::make_shared<const std::string>(name));
+    }
+    return it->second;
+}
+
+LayerTable::LayerId LayerTable::find(const std::string& name) const
+{
+    auto it = _index.find(name);
+    return it != _index.end() ? it->second : INVALID_ID;
+}
+
+void LayerTable::mergeState(const LayerTable& other)
+{
+    for (const auto& layer : other._layers) {
+        LayerInfo& info = _layers[intern(layer.name)];
+        info.color[0] = layer.color[0];
+        info.color[1] = layer.color[1];
+        info.color[2] = layer.color[2];
+        info.visible = layer.visible;
+        info.frozen = layer.frozen;
+    }
+}
+
+void LayerTable::clear()
+{
+    _layers.clear();
+    _names.clear();
+    _index.clear();
+}
+
+void LayerTable::AciToRgb(int aci, float rgb[3])
+{
+    // 1..7 are the named colors, 7 is white on a dark background
+    static const float named[8][3] = {
+        { 1.0f, 1.0f, 1.0f },
+        { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+        { 0.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f },
+        { 1.0f, 1.0f, 1.0f },
+    };
+    if (aci < 0) aci = -aci;
+    if (aci >= 1 && aci <= 7) {
+        rgb[0] = named[aci][0];
+        rgb[1] = named[aci][1];
+        rgb[2] = named[aci][2];
+        return;
+    }
+    rgb[0] = rgb[1] = rgb[2] = 0.6f;
+}
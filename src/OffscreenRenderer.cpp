@@ -0,0 +1,133 @@
+#include "OffscreenRenderer.h"
+#include <algorithm>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLVersionFunctionsFactory>
+#include <QSurfaceFormat>
+#include "Camera.h"
+#include "Entities/Block.h"
+#include "Render2D.h"
+
+OffscreenRenderer::OffscreenRenderer() = default;
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+    // GL objects go with the context that made them
+    if (_context && _context->makeCurrent(_surface.get())) {
+        if (_renderer) {
+            auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(_context.get());
+            if (f) _renderer->clearEntities(f);
+        }
+        _renderer.reset();
+        _fbo.reset();
+        _context->doneCurrent();
+    }
+}
+
+bool OffscreenRenderer::init(QString* error)
+{
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    _surface = std::make_unique<QOffscreenSurface>();
+    _surface->setFormat(format);
+    _surface->create();
+
+    _context = std::make_unique<QOpenGLContext>();
+    _context->setFormat(format);
+    if (!_context->create() || !_context->makeCurrent(_surface.get())) {
+        if (error) *error = "cannot create an OpenGL 3.3 core context";
+        _context.reset();
+        return false;
+    }
+    auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(_context.get());
+    if (!f || !f->initializeOpenGLFunctions()) {
+        if (error) *error = "OpenGL 3.3 core functions are unavailable";
+        _context->doneCurrent();
+        _context.reset();
+        return false;
+    }
+    _context->doneCurrent();
+    return true;
+}
+
+QImage OffscreenRenderer::render(const std::vector<std::shared_ptr<Entity>>& entities, const LayerTable& layers,
+    const QSize& size, const QColor& background, float margin)
+{
+    if (!_context || size.isEmpty() || !_context->makeCurrent(_surface.get()))
+        return {};
+    auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(_context.get());
+
+    if (!_fbo || _fbo->size() != size)
+        _fbo = std::make_unique<QOpenGLFramebufferObject>(size);
+    _fbo->bind();
+
+    if (!_renderer) {
+        _renderer = std::make_unique<Render2D>(size.width(), size.height());
+        _renderer->initGL(f);
+        _renderer->setAxesVisible(false);
+    }
+    _renderer->resize(size.width(), size.height(), f);
+
+    _renderer->setLayers(layers);
+    for (const auto& entity : entities)
+        _renderer->addEntity(entity);
+    _renderer->zoomToExtents(margin);
+
+    f->glClearColor(background.redF(), background.greenF(), background.blueF(), 1.0f);
+    _renderer->render(f);
+    QImage image = _fbo->toImage().convertToFormat(QImage::Format_RGB32);
+
+    // The next drawing starts from an empty scene; programs and targets stay
+    _renderer->clearEntities(f);
+    _fbo->release();
+    _context->doneCurrent();
+    return image;
+}
+
+void OffscreenRenderer::tessellateFor(const std::vector<std::shared_ptr<Entity>>& entities,
+    const QSize& size, float margin)
+{
+    float extents[4];
+    bool any = false;
+    for (const auto& entity : entities) {
+        float b[4];
+        if (!entity->getBounds(b)) continue;
+        if (!any) {
+            std::copy(b, b + 4, extents);
+            any = true;
+            continue;
+        }
+        extents[0] = std::min(extents[0], b[0]);
+        extents[1] = std::min(extents[1], b[1]);
+        extents[2] = std::max(extents[2], b[2]);
+        extents[3] = std::max(extents[3], b[3]);
+    }
+    if (!any) return;
+
+    float scale = Camera2D::FitScale(static_cast<float>(size.width()), static_cast<float>(size.height()), extents, margin);
+    float chordTolerance = Render2D::getChordTolerance(Render2D::getLodLevelForScale(scale));
+    std::vector<float> vertices;
+    for (const auto& entity : entities) {
+        if (!Render2D::drawsAnalytically(*entity) && entity->tessellate(chordTolerance, vertices))
+            entity->setVertices(std::move(vertices));
+    }
+
+    // Block members are flattened into the block, so they are tessellated for
+    // the largest scale the block is inserted at and every block is rebuilt.
+    // Block boxes above still came from the coarse load; arcs only grow them,
+    // so the zoom was overestimated and the tolerance errs on the fine side.
+    auto blockScales = Render2D::getBlockScales(entities);
+    for (auto& [block, blockScale] : blockScales) {
+        float blockTolerance = blockScale > 0.0f ? chordTolerance / blockScale : chordTolerance;
+        for (const auto& entity : block->getEntities()) {
+            if (entity->tessellate(blockTolerance, vertices))
+                entity->setVertices(std::move(vertices));
+        }
+        block->invalidate();
+    }
+    for (auto& [block, blockScale] : blockScales)
+        block->build();
+}
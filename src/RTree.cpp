@@ -0,0 +1,177 @@
+#include "RTree.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr std::uint32_t kNodeSize = 16;
+// The tail is repacked into the tree once it holds more than this many ids
+// and more than 1/kTailFraction of the indexed ones
+constexpr size_t kMinTail = 256;
+constexpr size_t kTailFraction = 8;
+
+bool HasBox(const float* b) { return b[0] <= b[2] && b[1] <= b[3]; }
+
+bool Overlaps(const float* b, float minX, float minY, float maxX, float maxY)
+{
+    return b[0] <= maxX && b[2] >= minX && b[1] <= maxY && b[3] >= minY;
+}
+
+bool Inside(const float* b, float minX, float minY, float maxX, float maxY)
+{
+    return b[0] >= minX && b[2] <= maxX && b[1] >= minY && b[3] <= maxY;
+}
+
+// Sort-Tile-Recursive order: slices by center x, each slice by center y,
+// so that consecutive runs of kNodeSize make compact nodes
+template <typename T, typename BoxOf>
+void StrSort(std::vector<T>& items, size_t begin, size_t end, BoxOf&& boxOf)
+{
+    auto centerX = [&](const T& item) { const float* b = boxOf(item); return b[0] + b[2]; };
+    auto centerY = [&](const T& item) { const float* b = boxOf(item); return b[1] + b[3]; };
+
+    const size_t n = end - begin;
+    const size_t nodeCount = (n + kNodeSize - 1) / kNodeSize;
+    const size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+    const size_t perSlice = slices * kNodeSize;
+
+    std::sort(items.begin() + begin, items.begin() + end,
+        [&](const T& a, const T& b) { return centerX(a) < centerX(b); });
+    for (size_t s = begin; s < end; s += perSlice) {
+        std::sort(items.begin() + s, items.begin() + std::min(s + perSlice, end),
+            [&](const T& a, const T& b) { return centerY(a) < centerY(b); });
+    }
+}
+
+}
+
+void RTree::clear()
+{
+    _bounds = nullptr;
+    _count = 0;
+    _items.clear();
+    _nodes.clear();
+    _levelStart.clear();
+    _tail.clear();
+}
+
+float RTree::BoxDistance(const float* b, float x, float y)
+{
+    float dx = std::max({ b[0] - x, 0.0f, x - b[2] });
+    float dy = std::max({ b[1] - y, 0.0f, y - b[3] });
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+void RTree::build(const std::vector<float>& bounds)
+{
+    clear();
+    _bounds = &bounds;
+    _count = bounds.size() / 4;
+
+    for (size_t i = 0; i < _count; ++i) {
+        if (HasBox(&bounds[i * 4]))
+            _items.push_back(static_cast<std::uint32_t>(i));
+    }
+    if (_items.empty()) return;
+
+    // Leaves over the ids
+    StrSort(_items, 0, _items.size(), [&](std::uint32_t id) { return &bounds[id * 4]; });
+    _levelStart.push_back(0);
+    for (size_t i = 0; i < _items.size(); i += kNodeSize) {
+        Node node{ { INFINITY, INFINITY, -INFINITY, -INFINITY },
+            static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(std::min<size_t>(kNodeSize, _items.size() - i)) };
+        for (std::uint32_t k = node.first; k < node.first + node.count; ++k) {
+            const float* b = &bounds[_items[k] * 4];
+            node.box[0] = std::min(node.box[0], b[0]);
+            node.box[1] = std::min(node.box[1], b[1]);
+            node.box[2] = std::max(node.box[2], b[2]);
+            node.box[3] = std::max(node.box[3], b[3]);
+        }
+        _nodes.push_back(node);
+    }
+
+    // Each level packs the one below until a single node is left
+    size_t levelBegin = 0;
+    while (_nodes.size() - levelBegin > 1) {
+        const size_t levelEnd = _nodes.size();
+        StrSort(_nodes, levelBegin, levelEnd, [](const Node& node) { return node.box; });
+        _levelStart.push_back(static_cast<std::uint32_t>(levelEnd));
+        for (size_t i = levelBegin; i < levelEnd; i += kNodeSize) {
+            Node parent{ { INFINITY, INFINITY, -INFINITY, -INFINITY },
+                static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(std::min<size_t>(kNodeSize, levelEnd - i)) };
+            for (std::uint32_t k = parent.first; k < parent.first + parent.count; ++k) {
+                const float* b = _nodes[k].box;
+                parent.box[0] = std::min(parent.box[0], b[0]);
+                parent.box[1] = std::min(parent.box[1], b[1]);
+                parent.box[2] = std::max(parent.box[2], b[2]);
+                parent.box[3] = std::max(parent.box[3], b[3]);
+            }
+            _nodes.push_back(parent);
+        }
+        levelBegin = levelEnd;
+    }
+    _levelStart.push_back(static_cast<std::uint32_t>(_nodes.size()));
+}
+
+void RTree::update()
+{
+    if (!_bounds) return;
+    const size_t count = _bounds->size() / 4;
+    for (size_t i = _count; i < count; ++i) {
+        if (HasBox(&(*_bounds)[i * 4]))
+            _tail.push_back(static_cast<std::uint32_t>(i));
+    }
+    _count = count;
+    if (_tail.size() > std::max(kMinTail, _items.size() / kTailFraction))
+        build(*_bounds);
+}
+
+template <typename Visit>
+void RTree::search(float minX, float minY, float maxX, float maxY, Visit&& visit) const
+{
+    for (std::uint32_t id : _tail)
+        visit(id);
+    searchNodes(minX, minY, maxX, maxY, visit);
+}
+
+template <typename Visit>
+void RTree::searchNodes(float minX, float minY, float maxX, float maxY, Visit&& visit) const
+{
+    if (_nodes.empty()) return;
+
+    const std::uint32_t leafEnd = _levelStart[1];
+    std::vector<std::uint32_t> stack;
+    for (std::uint32_t n = _levelStart[_levelStart.size() - 2]; n < _nodes.size(); ++n)
+        stack.push_back(n);
+    while (!stack.empty()) {
+        const Node& node = _nodes[stack.back()];
+        const bool leaf = stack.back() < leafEnd;
+        stack.pop_back();
+        if (!Overlaps(node.box, minX, minY, maxX, maxY)) continue;
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (leaf)
+                visit(_items[i]);
+            else
+                stack.push_back(i);
+        }
+    }
+}
+
+void RTree::query(float minX, float minY, float maxX, float maxY, std::vector<std::uint32_t>& out) const
+{
+    if (!_bounds) return;
+    const std::vector<float>& bounds = *_bounds;
+    search(minX, minY, maxX, maxY, [&](std::uint32_t id) {
+        if (Overlaps(&bounds[id * 4], minX, minY, maxX, maxY)) out.push_back(id);
+    });
+}
+
+void RTree::queryContained(float minX, float minY, float maxX, float maxY, std::vector<std::uint32_t>& out) const
+{
+    if (!_bounds) return;
+    const std::vector<float>& bounds = *_bounds;
+    search(minX, minY, maxX, maxY, [&](std::uint32_t id) {
+        if (Inside(&bounds[id * 4], minX, minY, maxX, maxY)) out.push_back(id);
+    });
+}
+
@@ -1,5 +1,13 @@
 #include "Render2D.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
 #include <iostream>
+#include <numeric>
+#include <unordered_set>
+#include "Entities/Polyline.h"
 
 static const char* vertexShaderSrc = R"(
 #version 330 core
@@ -26,6 +34,236 @@ void main() {
 }
 )";
 
+// Shared by every program that draws scene entities: the selection and hover
+// state of each entity is one byte in a buffer texture. The cached scene is
+// drawn with uStateMask 0; the overlay pass redraws the selected and hovered
+// entities with the state applied, lightening the hovered one.
+static const char* stateLookupSrc = R"(
+uniform usamplerBuffer uStates;
+uniform uint uStateMask;
+vec4 applyState(vec4 color, uint entity) {
+    uint state = texelFetch(uStates, int(entity)).r & uStateMask;
+    if ((state & 2u) != 0u)
+        return vec4(mix(color.rgb, vec3(1.0), 0.35), 1.0);
+    return color;
+}
+)";
+
+// Inserts text right after the #version line
+static std::string InsertAfterVersion(const char* source, const char* text)
+{
+    std::string result(source);
+    size_t at = result.find('\n', result.find("#version")) + 1;
+    result.insert(at, text);
+    return result;
+}
+
+static std::string WithStateLookup(const char* source)
+{
+    return InsertAfterVersion(source, stateLookupSrc);
+}
+
+// Batched scene: every vertex carries its entity id, which looks up the
+// entity's color and alpha in a buffer texture
+static const char* sceneVertexShaderSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in uint aEntity;
+uniform mat4 uProjection;
+uniform samplerBuffer uStyles;
+out vec4 vColor;
+flat out uint vEntity;
+void main() {
+    vColor = applyState(texelFetch(uStyles, int(aEntity)), aEntity);
+    vEntity = aEntity;
+    gl_Position = uProjection * vec4(aPos, 0.0, 1.0);
+}
+)";
+
+static const char* sceneFragmentShaderSrc = R"(
+#version 330 core
+in vec4 vColor;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vColor;
+}
+)";
+
+// Pick pass: entity id + 1 into an integer framebuffer, 0 is background
+static const char* pickFragmentShaderSrc = R"(
+#version 330 core
+flat in uint vEntity;
+out uint PickId;
+
+void main() {
+    PickId = vEntity + 1u;
+}
+)";
+
+// Circles and arcs: one screen-aligned quad per instance around the circle.
+// The fragment shader measures the distance to the exact curve, so the line
+// stays one pixel wide and round at any zoom. Compiled with PICK defined it
+// writes the entity id of the covered pixels instead.
+static const char* curveVertexShaderSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 aCorner;      // quad corner in [-1, 1]
+layout(location = 1) in vec3 aCircle;      // center, radius
+layout(location = 2) in vec2 aSweep;       // start angle, counter-clockwise sweep
+layout(location = 3) in uint aEntity;
+uniform mat4 uProjection;
+uniform float uPixelSize;                  // world units per pixel
+uniform samplerBuffer uStyles;
+out vec2 vLocal;
+flat out vec3 vCircle;
+flat out vec2 vSweep;
+flat out vec4 vColor;
+flat out uint vEntity;
+void main() {
+    vLocal = aCorner * (aCircle.z + 2.0 * uPixelSize);
+    vCircle = aCircle;
+    vSweep = aSweep;
+    vColor = applyState(texelFetch(uStyles, int(aEntity)), aEntity);
+    vEntity = aEntity;
+    gl_Position = uProjection * vec4(aCircle.xy + vLocal, 0.0, 1.0);
+}
+)";
+
+static const char* curveFragmentShaderSrc = R"(
+#version 330 core
+in vec2 vLocal;
+flat in vec3 vCircle;
+flat in vec2 vSweep;
+flat in vec4 vColor;
+uniform float uPixelSize;
+#ifdef PICK
+flat in uint vEntity;
+out uint PickId;
+#else
+out vec4 FragColor;
+#endif
+const float TWO_PI = 6.28318530718;
+
+void main() {
+    float radius = vCircle.z;
+    float dist = abs(length(vLocal) - radius);
+    if (vSweep.y < TWO_PI && mod(atan(vLocal.y, vLocal.x) - vSweep.x, TWO_PI) > vSweep.y) {
+        // Outside the sweep the nearest point is an endpoint
+        float endAngle = vSweep.x + vSweep.y;
+        vec2 p0 = radius * vec2(cos(vSweep.x), sin(vSweep.x));
+        vec2 p1 = radius * vec2(cos(endAngle), sin(endAngle));
+        dist = min(distance(vLocal, p0), distance(vLocal, p1));
+    }
+    float coverage = 1.0 - dist / uPixelSize;
+    if (coverage <= 0.0) discard;
+#ifdef PICK
+    PickId = vEntity + 1u;
+#else
+    FragColor = vec4(vColor.rgb, vColor.a * min(coverage, 1.0));
+#endif
+}
+)";
+
+// Cached scene texture over the whole viewport. The texture holds
+// premultiplied color, so uAlpha fades it evenly toward the background.
+static const char* compositeVertexShaderSrc = R"(
+#version 330 core
+out vec2 vUv;
+void main() {
+    // One triangle covering the viewport
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    vUv = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+static const char* compositeFragmentShaderSrc = R"(
+#version 330 core
+in vec2 vUv;
+uniform sampler2D uScene;
+uniform float uAlpha;
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(uScene, vUv) * uAlpha;
+}
+)";
+
+// Block geometry placed by a per-instance affine transform; the insert's
+// entity id supplies its alpha and selection state
+static const char* instanceVertexShaderSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec3 aRow0;
+layout(location = 2) in vec3 aRow1;
+layout(location = 3) in uint aEntity;
+uniform mat4 uProjection;
+uniform vec3 uColor;
+uniform samplerBuffer uStyles;
+out vec4 vColor;
+flat out uint vEntity;
+void main() {
+    vec3 p = vec3(aPos, 1.0);
+    vec2 world = vec2(dot(aRow0, p), dot(aRow1, p));
+    vColor = applyState(vec4(uColor, texelFetch(uStyles, int(aEntity)).a), aEntity);
+    vEntity = aEntity;
+    gl_Position = uProjection * vec4(world, 0.0, 1.0);
+}
+)";
+
+static const char* instanceFragmentShaderSrc = R"(
+#version 330 core
+in vec4 vColor;
+out vec4 FragColor;
+
+void main() {
+    FragColor = vColor;
+}
+)";
+
+// Markers: a screen-aligned quad of uSize pixels around each point, corners
+// from gl_VertexID. The fragment shader cuts out an antialiased ring, so the
+// geometry underneath stays visible.
+static const char* markerVertexShaderSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec4 aColor;
+uniform mat4 uProjection;
+uniform vec2 uViewport;                    // in pixels
+uniform float uSize;                       // diameter in pixels
+out vec2 vLocal;                           // from the center, in pixels
+flat out vec4 vColor;
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vLocal = corner * (0.5 * uSize + 1.0);
+    vColor = aColor;
+    vec4 center = uProjection * vec4(aPos, 0.0, 1.0);
+    gl_Position = center + vec4(vLocal * 2.0 / uViewport * center.w, 0.0, 0.0);
+}
+)";
+
+static const char* markerFragmentShaderSrc = R"(
+#version 330 core
+in vec2 vLocal;
+flat in vec4 vColor;
+uniform float uSize;
+out vec4 FragColor;
+
+void main() {
+    float dist = abs(length(vLocal) - 0.5 * uSize + 1.0);
+    float coverage = 1.5 - dist;
+    if (coverage <= 0.0) discard;
+    FragColor = vec4(vColor.rgb, vColor.a * min(coverage, 1.0));
+}
+)";
+
+// Opaque RGBA8, byte order R, G, B, A in memory on little-endian machines
+static std::uint32_t PackRgba(const float color[3])
+{
+    auto toByte = [](float v) { return static_cast<std::uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return toByte(color[0]) | (toByte(color[1]) << 8) | (toByte(color[2]) << 16) | (255u << 24);
+}
+
 Render2D::Render2D(int width, int height)
     : _width(width), _height(height), _shaderProgram(0),
     _camera((float)width, (float)height)
@@ -40,12 +278,249 @@ Render2D::~Render2D()
 
 void Render2D::addEntity(std::shared_ptr<Entity> entity)
 {
-    _entities.push_back(entity);
+    SceneStore::EntityId id = _store.add(*entity);
+    if (auto* insert = dynamic_cast<Insert*>(entity.get())) {
+        // Drawn instanced from the block batch
+        LayerTable::LayerId layer = _store.getLayerId(id);
+        BlockBatch& batch = _blockBatches[{ insert->getBlock().get(), layer }];
+        batch.block = insert->getBlock();
+        batch.layer = layer;
+        _insertSlots[id] = { &batch, static_cast<std::uint32_t>(batch.instances.size()) };
+        batch.instances.push_back(id);
+        batch.instancesDirty = true;
+    }
+
+    _entityIndex[entity.get()] = id;
+    _entities.push_back(std::move(entity));
+}
+
+void Render2D::updateEntity(const Entity* entity)
+{
+    auto it = _entityIndex.find(entity);
+    if (it != _entityIndex.end()) {
+        _store.updateGeometry(it->second, *entity);
+        _grid.move(it->second);
+        _spatialIndexStale = true;
+    }
+}
+
+void Render2D::updateBlockGeometry(const std::vector<BlockDefinition*>& blocks)
+{
+    const std::unordered_set<const BlockDefinition*> rebuilt(blocks.begin(), blocks.end());
+    for (auto& [key, batch] : _blockBatches) {
+        if (!rebuilt.count(batch.block.get())) continue;
+        batch.geometryDirty = true;
+        for (SceneStore::EntityId id : batch.instances) {
+            _store.updateBounds(id, *_entities[id]);
+            _grid.move(id);
+        }
+    }
+    _spatialIndexStale = true;
+}
+
+void Render2D::setLayers(const LayerTable& layers)
+{
+    _store.getLayers().mergeState(layers);
+    ++_appearanceVersion;
+}
+
+void Render2D::setLayerVisible(const std::string& name, bool visible)
+{
+    LayerTable& layers = _store.getLayers();
+    LayerTable::LayerId id = layers.find(name);
+    if (id != LayerTable::INVALID_ID)
+        layers.get(id).visible = visible;
+    ++_appearanceVersion;
+}
+
+void Render2D::isolateLayer(const std::string& name)
+{
+    LayerTable& layers = _store.getLayers();
+    for (LayerTable::LayerId id = 0; id < layers.size(); ++id) {
+        LayerInfo& layer = layers.get(id);
+        layer.visible = name.empty() || layer.name == name;
+    }
+    ++_appearanceVersion;
+}
+
+std::vector<std::shared_ptr<Entity>> Render2D::getLayerEntities(const std::string& name,
+    std::vector<std::shared_ptr<Entity>>* otherLayers) const
+{
+    std::vector<std::shared_ptr<Entity>> result;
+    const LayerTable& layers = _store.getLayers();
+    LayerTable::LayerId wanted = layers.find(name);
+
+    for (LayerTable::LayerId layer = 0; layer < layers.size(); ++layer) {
+        std::vector<std::shared_ptr<Entity>>* out = layer == wanted ? &result : otherLayers;
+        if (!out) continue;
+        for (SceneStore::EntityId id : _store.getLayerEntities(layer))
+            out->push_back(_entities[id]);
+    }
+    return result;
+}
+
+void Render2D::syncSceneBuffer(QOpenGLFunctions_3_3_Core* f)
+{
+    const auto uploadStart = std::chrono::steady_clock::now();
+    const auto& pool = _store.getVertexPool();
+    const auto& owners = _store.getVertexOwners();
+
+    if (_sceneVao == 0) {
+        f->glGenVertexArrays(1, &_sceneVao);
+        f->glGenBuffers(1, &_sceneVbo);
+        f->glGenBuffers(1, &_sceneOwnerVbo);
+        f->glBindVertexArray(_sceneVao);
+        // Attribute 0: 2 floats per vertex (x,y)
+        f->glBindBuffer(GL_ARRAY_BUFFER, _sceneVbo);
+        f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), reinterpret_cast<void*>(0));
+        f->glEnableVertexAttribArray(0);
+        // Attribute 1: owning entity id per vertex
+        f->glBindBuffer(GL_ARRAY_BUFFER, _sceneOwnerVbo);
+        f->glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(std::uint32_t), reinterpret_cast<void*>(0));
+        f->glEnableVertexAttribArray(1);
+        f->glBindVertexArray(0);
+
+        f->glGenBuffers(1, &_styleBuffer);
+        f->glGenTextures(1, &_styleTexture);
+        f->glGenBuffers(1, &_stateBuffer);
+        f->glGenTextures(1, &_stateTexture);
+    }
+
+    // Both vertex buffers hold one entry per pool vertex and share the dirty range
+    const size_t ownerBytes = sizeof(std::uint32_t);
+    if (pool.size() > _sceneVboCapacity || _store.isRebuilt()) {
+        // Grow geometrically so streaming a load in costs amortized linear uploads
+        if (pool.size() > _sceneVboCapacity)
+            _sceneVboCapacity = std::max(pool.size() + pool.size() / 2, size_t(1) << 16);
+        f->glBindBuffer(GL_ARRAY_BUFFER, _sceneVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, _sceneVboCapacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        f->glBufferSubData(GL_ARRAY_BUFFER, 0, pool.size() * sizeof(float), pool.data());
+        f->glBindBuffer(GL_ARRAY_BUFFER, _sceneOwnerVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, _sceneVboCapacity / 2 * ownerBytes, nullptr, GL_DYNAMIC_DRAW);
+        f->glBufferSubData(GL_ARRAY_BUFFER, 0, owners.size() * ownerBytes, owners.data());
+    }
+    else {
+        // Appends and rewrites since the last frame, in place in the sized buffers;
+        // a batch of added entities is one contiguous range
+        _store.getDirtyRanges(kUploadMergeGap, _uploadRanges);
+        for (auto [begin, end] : _uploadRanges) {
+            f->glBindBuffer(GL_ARRAY_BUFFER, _sceneVbo);
+            f->glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(float), (end - begin) * sizeof(float), pool.data() + begin);
+            f->glBindBuffer(GL_ARRAY_BUFFER, _sceneOwnerVbo);
+            f->glBufferSubData(GL_ARRAY_BUFFER, begin / 2 * ownerBytes, (end - begin) / 2 * ownerBytes, owners.data() + begin / 2);
+        }
+    }
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Per-entity color and alpha, one RGBA8 texel per entity; sized like the
+    // vertex buffers so adding entities only writes their own texels
+    const size_t styleBytes = sizeof(std::uint32_t);
+    if (_store.isStyleDirty()) {
+        ++_appearanceVersion;
+        _store.packStyles(_styleData);
+    }
+    if (_styleData.size() > _styleCapacity) {
+        _styleCapacity = std::max(_styleData.size() + _styleData.size() / 2, size_t(1) << 12);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, _styleBuffer);
+        f->glBufferData(GL_TEXTURE_BUFFER, _styleCapacity * styleBytes, nullptr, GL_DYNAMIC_DRAW);
+        f->glBufferSubData(GL_TEXTURE_BUFFER, 0, _styleData.size() * styleBytes, _styleData.data());
+        f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        f->glBindTexture(GL_TEXTURE_BUFFER, _styleTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, _styleBuffer);
+        f->glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else if (_store.isStyleDirty()) {
+        f->glBindBuffer(GL_TEXTURE_BUFFER, _styleBuffer);
+        for (auto [begin, end] : _store.getStyleDirtyRuns())
+            f->glBufferSubData(GL_TEXTURE_BUFFER, begin * styleBytes, (end - begin) * styleBytes, _styleData.data() + begin);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Selection and hover state, one byte per entity; a click only rewrites
+    // the runs of changed entries, so hovering at one end of the scene and
+    // selecting at the other does not upload everything between
+    const auto& states = _store.getStates();
+    if (states.size() > _stateCapacity) {
+        _stateCapacity = std::max(states.size() + states.size() / 2, size_t(1) << 12);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, _stateBuffer);
+        f->glBufferData(GL_TEXTURE_BUFFER, _stateCapacity, nullptr, GL_DYNAMIC_DRAW);
+        f->glBufferSubData(GL_TEXTURE_BUFFER, 0, states.size(), states.data());
+        f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        f->glBindTexture(GL_TEXTURE_BUFFER, _stateTexture);
+        f->glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, _stateBuffer);
+        f->glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    else if (!_store.getStateDirtyRuns().empty()) {
+        f->glBindBuffer(GL_TEXTURE_BUFFER, _stateBuffer);
+        for (auto [begin, end] : _store.getStateDirtyRuns())
+            f->glBufferSubData(GL_TEXTURE_BUFFER, begin, end - begin, states.data() + begin);
+        f->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    _store.markUploaded();
+    _frameStats.addCpuTime(FrameStats::Upload, FrameStats::ElapsedMs(uploadStart));
+
+    // Pick LOD levels per zoom octave; 2^-level never exceeds the real pixel
+    // size, so the lists only rebuild when the octave changes
+    FrameStats::Timer timer(_frameStats, FrameStats::Batch);
+    _store.setLodPixelSize(std::ldexp(1.0f, -getLodLevel()));
+    _store.updateDrawLists();
+}
+
+GLenum Render2D::glMode(Entity::DrawMode mode)
+{
+    switch (mode) {
+    case Entity::DrawMode::Lines: return GL_LINES;
+    case Entity::DrawMode::LineLoop: return GL_LINE_LOOP;
+    case Entity::DrawMode::LineStrip: break;
+    }
+    return GL_LINE_STRIP;
 }
 
 void Render2D::initGL(QOpenGLFunctions_3_3_Core* f)
 {
     _shaderProgram = createShaderProgram(f, vertexShaderSrc, fragmentShaderSrc);
+    _sceneProgram = createShaderProgram(f, WithStateLookup(sceneVertexShaderSrc).c_str(), sceneFragmentShaderSrc);
+    _curveProgram = createShaderProgram(f, WithStateLookup(curveVertexShaderSrc).c_str(), curveFragmentShaderSrc);
+    _instanceProgram = createShaderProgram(f, WithStateLookup(instanceVertexShaderSrc).c_str(), instanceFragmentShaderSrc);
+    _pickSceneProgram = createShaderProgram(f, WithStateLookup(sceneVertexShaderSrc).c_str(), pickFragmentShaderSrc);
+    _pickCurveProgram = createShaderProgram(f, WithStateLookup(curveVertexShaderSrc).c_str(),
+        InsertAfterVersion(curveFragmentShaderSrc, "#define PICK\n").c_str());
+    _pickInstanceProgram = createShaderProgram(f, WithStateLookup(instanceVertexShaderSrc).c_str(), pickFragmentShaderSrc);
+    _compositeProgram = createShaderProgram(f, compositeVertexShaderSrc, compositeFragmentShaderSrc);
+    _markerProgram = createShaderProgram(f, markerVertexShaderSrc, markerFragmentShaderSrc);
+
+    // Looked up once instead of every frame
+    _uniforms.projection = f->glGetUniformLocation(_shaderProgram, "uProjection");
+    _uniforms.color = f->glGetUniformLocation(_shaderProgram, "uColor");
+    _uniforms.alpha = f->glGetUniformLocation(_shaderProgram, "alpha");
+    _uniforms.sceneProjection = f->glGetUniformLocation(_sceneProgram, "uProjection");
+    _uniforms.curveProjection = f->glGetUniformLocation(_curveProgram, "uProjection");
+    _uniforms.curvePixelSize = f->glGetUniformLocation(_curveProgram, "uPixelSize");
+    _uniforms.instanceProjection = f->glGetUniformLocation(_instanceProgram, "uProjection");
+    _uniforms.instanceColor = f->glGetUniformLocation(_instanceProgram, "uColor");
+    _uniforms.sceneStateMask = f->glGetUniformLocation(_sceneProgram, "uStateMask");
+    _uniforms.curveStateMask = f->glGetUniformLocation(_curveProgram, "uStateMask");
+    _uniforms.instanceStateMask = f->glGetUniformLocation(_instanceProgram, "uStateMask");
+    _uniforms.compositeAlpha = f->glGetUniformLocation(_compositeProgram, "uAlpha");
+    _uniforms.pickSceneProjection = f->glGetUniformLocation(_pickSceneProgram, "uProjection");
+    _uniforms.pickCurveProjection = f->glGetUniformLocation(_pickCurveProgram, "uProjection");
+    _uniforms.pickCurvePixelSize = f->glGetUniformLocation(_pickCurveProgram, "uPixelSize");
+    _uniforms.pickInstanceProjection = f->glGetUniformLocation(_pickInstanceProgram, "uProjection");
+    _uniforms.markerProjection = f->glGetUniformLocation(_markerProgram, "uProjection");
+    _uniforms.markerViewport = f->glGetUniformLocation(_markerProgram, "uViewport");
+    _uniforms.markerSize = f->glGetUniformLocation(_markerProgram, "uSize");
+
+    // Styles on texture unit 0, states on unit 1
+    for (GLuint program : { _sceneProgram, _curveProgram, _instanceProgram,
+                            _pickSceneProgram, _pickCurveProgram, _pickInstanceProgram }) {
+        f->glUseProgram(program);
+        f->glUniform1i(f->glGetUniformLocation(program, "uStyles"), 0);
+        f->glUniform1i(f->glGetUniformLocation(program, "uStates"), 1);
+    }
+    // The cached scene on unit 2
+    f->glUseProgram(_compositeProgram);
+    f->glUniform1i(f->glGetUniformLocation(_compositeProgram, "uScene"), 2);
 
     f->glEnable(GL_BLEND);
     f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -69,33 +544,689 @@ void Render2D::setupProjection(QOpenGLFunctions_3_3_Core* f)
         -1.0f, 1.0f);
 
     f->glUseProgram(_shaderProgram);
-    GLint projLoc = f->glGetUniformLocation(_shaderProgram, "uProjection");
-    f->glUniformMatrix4fv(projLoc, 1, GL_FALSE, &_projection[0][0]);
+    f->glUniformMatrix4fv(_uniforms.projection, 1, GL_FALSE, &_projection[0][0]);
+}
+
+bool Render2D::drawSceneLines(QOpenGLFunctions_3_3_Core* f)
+{
+    f->glBindVertexArray(_sceneVao);
+
+    static constexpr Entity::DrawMode modes[] = {
+        Entity::DrawMode::Lines, Entity::DrawMode::LineStrip, Entity::DrawMode::LineLoop };
+    auto multiDraw = [this, f](GLenum mode, const SceneStore::DrawList& list) {
+        if (list.first.empty()) return;
+        f->glMultiDrawArrays(mode, list.first.data(), list.count.data(), static_cast<GLsizei>(list.first.size()));
+        _frameStats.countDraw(std::accumulate(list.count.begin(), list.count.end(), std::uint64_t(0)));
+    };
+
+    {
+        // Appended entities join the grid's tail; only a full tail rebuilds it
+        FrameStats::Timer timer(_frameStats, FrameStats::Cull);
+        if (_gridStale) {
+            _grid.build(_store.getAllBounds());
+            _gridStale = false;
+        }
+        else {
+            _grid.update();
+        }
+    }
+
+    const LayerTable& layers = _store.getLayers();
+    float view[4];
+    _camera.getWorldRect(view);
+    const bool wholeScene = _grid.covers(view[0], view[1], view[2], view[3]);
+    if (wholeScene) {
+        // Whole drawing on screen: one multi-draw per visible layer and primitive
+        // type from the prebuilt lists; a hidden layer costs nothing
+        for (LayerTable::LayerId layer = 0; layer < layers.size(); ++layer) {
+            if (!layers.get(layer).isDrawn()) continue;
+            for (Entity::DrawMode mode : modes)
+                multiDraw(glMode(mode), _store.getDrawList(layer, mode));
+            multiDraw(GL_POINTS, _store.getPointList(layer));
+        }
+    }
+    else {
+        // Zoomed in: only the entities in tiles under the camera rectangle
+        {
+            FrameStats::Timer timer(_frameStats, FrameStats::Cull);
+            _visibleIds.clear();
+            _grid.query(view[0], view[1], view[2], view[3], _visibleIds);
+        }
+        {
+            FrameStats::Timer timer(_frameStats, FrameStats::Batch);
+            for (auto& list : _culledLists) {
+                list.first.clear();
+                list.count.clear();
+            }
+            for (SceneStore::EntityId id : _visibleIds) {
+                if (_store.getVertexCount(id) == 0 || !layers.get(_store.getLayerId(id)).isDrawn()) continue;
+                SceneStore::DrawRange range = _store.getDrawRange(id);
+                _culledLists[range.list].first.push_back(range.first);
+                _culledLists[range.list].count.push_back(range.count);
+            }
+        }
+        for (Entity::DrawMode mode : modes)
+            multiDraw(glMode(mode), _culledLists[static_cast<size_t>(mode)]);
+        multiDraw(GL_POINTS, _culledLists[SceneStore::POINT_LIST]);
+    }
+    f->glBindVertexArray(0);
+    return !wholeScene;
+}
+
+void Render2D::setStateMask(QOpenGLFunctions_3_3_Core* f, GLuint mask)
+{
+    f->glUseProgram(_sceneProgram);
+    f->glUniform1ui(_uniforms.sceneStateMask, mask);
+    f->glUseProgram(_curveProgram);
+    f->glUniform1ui(_uniforms.curveStateMask, mask);
+    f->glUseProgram(_instanceProgram);
+    f->glUniform1ui(_uniforms.instanceStateMask, mask);
+}
+
+void Render2D::renderSceneCache(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj)
+{
+    GLint previous = 0;
+    f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+
+    if (_sceneCacheFbo == 0) {
+        f->glGenFramebuffers(1, &_sceneCacheFbo);
+        f->glGenTextures(1, &_sceneCacheTexture);
+        f->glGenVertexArrays(1, &_compositeVao);
+        _sceneCacheWidth = _sceneCacheHeight = 0;
+    }
+    f->glBindFramebuffer(GL_FRAMEBUFFER, _sceneCacheFbo);
+    if (_sceneCacheWidth != _width || _sceneCacheHeight != _height) {
+        f->glBindTexture(GL_TEXTURE_2D, _sceneCacheTexture);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        f->glBindTexture(GL_TEXTURE_2D, 0);
+        f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _sceneCacheTexture, 0);
+        _sceneCacheWidth = _width;
+        _sceneCacheHeight = _height;
+    }
+
+    // Transparent background; blending alpha this way leaves premultiplied color
+    const float transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    f->glClearBufferfv(GL_COLOR, 0, transparent);
+    f->glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    setStateMask(f, 0);
+
+    f->glUseProgram(_sceneProgram);
+    f->glUniformMatrix4fv(_uniforms.sceneProjection, 1, GL_FALSE, &viewProj[0][0]);
+    bool culled = drawSceneLines(f);
+    renderCurves(f, viewProj, culled);
+    renderBlocks(f, viewProj, culled);
+
+    f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous));
+
+    _sceneCacheViewProj = viewProj;
+    _sceneCacheGeometryVersion = _store.getGeometryVersion();
+    _sceneCacheAppearanceVersion = _appearanceVersion;
+    _sceneCacheValid = true;
+}
+
+void Render2D::renderOverlay(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj)
+{
+    _overlayIds = _store.getSelection();
+    SceneStore::EntityId hovered = _store.getHovered();
+    if (hovered != SceneStore::INVALID_ID && !(_store.getState(hovered) & SceneStore::Selected))
+        _overlayIds.push_back(hovered);
+    if (_overlayIds.empty()) return;
+
+    {
+        FrameStats::Timer timer(_frameStats, FrameStats::Batch);
+        // Sorted by id, so overlapping highlights stack in draw order
+        std::sort(_overlayIds.begin(), _overlayIds.end());
+        const LayerTable& layers = _store.getLayers();
+        for (auto& list : _overlayLists) {
+            list.first.clear();
+            list.count.clear();
+        }
+        _overlayCurves.clear();
+        _overlayInserts.clear();
+        for (SceneStore::EntityId id : _overlayIds) {
+            if (!layers.get(_store.getLayerId(id)).isDrawn()) continue;
+            if (_store.getVertexCount(id)) {
+                SceneStore::DrawRange range = _store.getDrawRange(id);
+                _overlayLists[range.list].first.push_back(range.first);
+                _overlayLists[range.list].count.push_back(range.count);
+            }
+            else if (_store.isCurve(id)) {
+                _overlayCurves.push_back(_store.getCurve(id));
+            }
+            else if (_insertSlots.count(id)) {
+                _overlayInserts.push_back(id);
+            }
+        }
+    }
+
+    setStateMask(f, SceneStore::Selected | SceneStore::Hovered);
+
+    f->glUseProgram(_sceneProgram);
+    f->glUniformMatrix4fv(_uniforms.sceneProjection, 1, GL_FALSE, &viewProj[0][0]);
+    f->glBindVertexArray(_sceneVao);
+    for (size_t mode = 0; mode < 4; ++mode) {
+        const auto& list = _overlayLists[mode];
+        if (list.first.empty()) continue;
+        GLenum primitive = mode == SceneStore::POINT_LIST ? GL_POINTS : glMode(static_cast<Entity::DrawMode>(mode));
+        f->glMultiDrawArrays(primitive, list.first.data(), list.count.data(), static_cast<GLsizei>(list.first.size()));
+        _frameStats.countDraw(std::accumulate(list.count.begin(), list.count.end(), std::uint64_t(0)));
+    }
+
+    if (!_overlayCurves.empty()) {
+        f->glUseProgram(_curveProgram);
+        f->glUniformMatrix4fv(_uniforms.curveProjection, 1, GL_FALSE, &viewProj[0][0]);
+        f->glUniform1f(_uniforms.curvePixelSize, static_cast<float>(1.0 / _camera.getScale()));
+        f->glBindVertexArray(_curveVao);
+        f->glBindBuffer(GL_ARRAY_BUFFER, _curveStreamVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, _overlayCurves.size() * sizeof(SceneStore::CurveInstance),
+            _overlayCurves.data(), GL_STREAM_DRAW);
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        setCurveInstances(f, _curveStreamVbo, 0);
+        f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_overlayCurves.size()));
+        _frameStats.countDraw(4 * std::uint64_t(_overlayCurves.size()));
+    }
+
+    if (!_overlayInserts.empty()) {
+        // One instance each, by pointing the batch's instance attributes at its slot
+        f->glUseProgram(_instanceProgram);
+        f->glUniformMatrix4fv(_uniforms.instanceProjection, 1, GL_FALSE, &viewProj[0][0]);
+        for (SceneStore::EntityId id : _overlayInserts) {
+            auto [batch, slot] = _insertSlots[id];
+            if (batch->block->getRanges().empty()) continue;
+            uploadBlockBatch(f, *batch);
+            f->glBindVertexArray(batch->vao);
+            setBlockInstances(f, batch->instanceVbo, slot);
+            for (const auto& range : batch->block->getRanges()) {
+                f->glUniform3fv(_uniforms.instanceColor, 1, range.color);
+                f->glDrawArraysInstanced(glMode(range.mode), range.first, range.count, 1);
+                _frameStats.countDraw(range.count);
+            }
+            setBlockInstances(f, batch->instanceVbo, 0);
+        }
+    }
+    f->glBindVertexArray(0);
 }
 
 void Render2D::render(QOpenGLFunctions_3_3_Core* f)
 {
-    f->glClear(GL_COLOR_BUFFER_BIT);
+    _frameStats.beginFrame();
+    bool timed = beginGpuTimer(f);
+    renderFrame(f);
+    if (timed) f->glEndQuery(GL_TIME_ELAPSED);
+    _frameStats.endFrame();
+}
 
-    f->glUseProgram(_shaderProgram);
+bool Render2D::beginGpuTimer(QOpenGLFunctions_3_3_Core* f)
+{
+    if (_gpuQueries[0] == 0)
+        f->glGenQueries(kGpuQueryCount, _gpuQueries);
 
-    glm::mat4 viewProj = _camera.getMatrix();
-    GLint loc = f->glGetUniformLocation(_shaderProgram, "uProjection");
-    f->glUniformMatrix4fv(loc, 1, GL_FALSE, &viewProj[0][0]);
+    // Never wait for a result, take the ones that are ready
+    for (size_t i = 0; i < kGpuQueryCount; ++i) {
+        if (!_gpuQueryPending[i]) continue;
+        GLuint available = 0;
+        f->glGetQueryObjectuiv(_gpuQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint64 nanoseconds = 0;
+        f->glGetQueryObjectui64v(_gpuQueries[i], GL_QUERY_RESULT, &nanoseconds);
+        _frameStats.addGpuTime(static_cast<double>(nanoseconds) / 1e6);
+        _gpuQueryPending[i] = false;
+    }
 
-    GLint colorLoc = f->glGetUniformLocation(_shaderProgram, "uColor");
+    size_t slot = _gpuQueryNext;
+    if (_gpuQueryPending[slot]) return false;
+    f->glBeginQuery(GL_TIME_ELAPSED, _gpuQueries[slot]);
+    _gpuQueryPending[slot] = true;
+    _gpuQueryNext = (slot + 1) % kGpuQueryCount;
+    return true;
+}
 
-    for (auto& entity : _entities) {
-        f->glUniform3fv(colorLoc, 1, entity->getColor());
-		f->glUniform1f(f->glGetUniformLocation(_shaderProgram, "alpha"), entity->getAlpha());
-        entity->draw(f);  // Entity::draw takes f
+size_t Render2D::getGpuBufferBytes() const
+{
+    size_t bytes = _sceneVboCapacity * sizeof(float) + _sceneVboCapacity / 2 * sizeof(std::uint32_t)
+        + _styleCapacity * sizeof(std::uint32_t) + _stateCapacity
+        + _curveCapacity * sizeof(SceneStore::CurveInstance) + _markerCapacity * sizeof(MarkerInstance);
+    for (const auto& [key, batch] : _blockBatches) {
+        if (batch.vao == 0) continue;
+        bytes += batch.block->getVertices().size() * sizeof(float) + batch.instances.size() * sizeof(InstanceData);
     }
+    return bytes;
+}
+
+size_t Render2D::getGpuTargetBytes() const
+{
+    // RGBA8 and R32UI, four bytes a pixel each
+    size_t bytes = 0;
+    if (_sceneCacheFbo != 0) bytes += static_cast<size_t>(_sceneCacheWidth) * _sceneCacheHeight * 4;
+    if (_pickFbo != 0) bytes += static_cast<size_t>(_pickWidth) * _pickHeight * 4;
+    return bytes;
+}
+
+void Render2D::renderFrame(QOpenGLFunctions_3_3_Core* f)
+{
+    f->glClear(GL_COLOR_BUFFER_BIT);
+
+    glm::mat4 viewProj = _camera.getMatrix();
+
+    syncSceneBuffer(f);
+    if (_width <= 0 || _height <= 0) return;
+    f->glActiveTexture(GL_TEXTURE1);
+    f->glBindTexture(GL_TEXTURE_BUFFER, _stateTexture);
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_BUFFER, _styleTexture);
+
+    // The static scene is redrawn only for a new camera, geometry or appearance;
+    // a click or hover just composites it again under the overlay
+    if (!_sceneCacheValid || _sceneCacheWidth != _width || _sceneCacheHeight != _height
+        || _sceneCacheGeometryVersion != _store.getGeometryVersion()
+        || _sceneCacheAppearanceVersion != _appearanceVersion || _sceneCacheViewProj != viewProj)
+        renderSceneCache(f, viewProj);
+
+    f->glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    f->glUseProgram(_compositeProgram);
+    f->glUniform1f(_uniforms.compositeAlpha, dimAlpha());
+    f->glActiveTexture(GL_TEXTURE2);
+    f->glBindTexture(GL_TEXTURE_2D, _sceneCacheTexture);
+    f->glBindVertexArray(_compositeVao);
+    f->glDrawArrays(GL_TRIANGLES, 0, 3);
+    _frameStats.countDraw(3);
+    f->glBindVertexArray(0);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    renderOverlay(f, viewProj);
+    f->glBindTexture(GL_TEXTURE_BUFFER, 0);
+    renderMarkers(f, viewProj);
+
+    if (!_axesVisible) return;
 
 	// Draw axes
-    f->glUniform3fv(colorLoc, 1, _xAxis->getColor());
+    f->glUseProgram(_shaderProgram);
+    f->glUniformMatrix4fv(_uniforms.projection, 1, GL_FALSE, &viewProj[0][0]);
+    f->glUniform1f(_uniforms.alpha, 1.0f);
+    f->glUniform3fv(_uniforms.color, 1, _xAxis->getColor());
     _xAxis->draw(f);
-    f->glUniform3fv(colorLoc, 1, _yAxis->getColor());
+    f->glUniform3fv(_uniforms.color, 1, _yAxis->getColor());
     _yAxis->draw(f);
+    _frameStats.countDraw(2);
+    _frameStats.countDraw(2);
+}
+
+void Render2D::setCurveInstances(QOpenGLFunctions_3_3_Core* f, GLuint buffer, size_t firstInstance)
+{
+    using Curve = SceneStore::CurveInstance;
+    const GLsizei stride = sizeof(Curve);
+    const size_t base = firstInstance * sizeof(Curve);
+    f->glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(base + offsetof(Curve, cx)));
+    f->glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(base + offsetof(Curve, startAngle)));
+    f->glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, stride, reinterpret_cast<void*>(base + offsetof(Curve, id)));
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Render2D::renderCurves(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj, bool culled, bool pick)
+{
+    const auto& curves = _store.getCurves();
+    if (curves.empty()) return;
+    const LayerTable& layers = _store.getLayers();
+
+    if (_curveVao == 0) {
+        static const float corners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        f->glGenVertexArrays(1, &_curveVao);
+        GLuint buffers[3];
+        f->glGenBuffers(3, buffers);
+        _curveQuadVbo = buffers[0];
+        _curveVbo = buffers[1];
+        _curveStreamVbo = buffers[2];
+
+        f->glBindVertexArray(_curveVao);
+        f->glBindBuffer(GL_ARRAY_BUFFER, _curveQuadVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), reinterpret_cast<void*>(0));
+        f->glEnableVertexAttribArray(0);
+        for (GLuint loc = 1; loc <= 3; ++loc) {
+            f->glEnableVertexAttribArray(loc);
+            f->glVertexAttribDivisor(loc, 1);
+        }
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        f->glBindVertexArray(0);
+    }
+
+    // Curves are only appended, so a new count means new curves (or a cleared scene)
+    if (curves.size() != _uploadedCurveCount) {
+        FrameStats::Timer timer(_frameStats, FrameStats::Upload);
+        if (curves.size() < _uploadedCurveCount) {
+            _curveSlices.clear();
+            _curveData.clear();
+            _uploadedCurveCount = 0;
+        }
+        _curveSlices.resize(layers.size());
+
+        // Grouped by layer, so each visible layer is one instanced draw
+        std::vector<std::uint32_t> added(layers.size(), 0);
+        for (size_t i = _uploadedCurveCount; i < curves.size(); ++i)
+            ++added[_store.getLayerId(curves[i].id)];
+        _curveDirty.clear();
+        for (size_t layer = 0; layer < added.size(); ++layer) {
+            if (added[layer] == 0) continue;
+            CurveSlice& slice = _curveSlices[layer];
+            const std::uint32_t needed = slice.count + added[layer];
+            if (needed <= slice.capacity) {
+                _curveDirty.emplace_back(slice.first + slice.count, slice.first + needed);
+                continue;
+            }
+            // Moved to the end; the old slice is left as a gap
+            const std::uint32_t first = static_cast<std::uint32_t>(_curveData.size());
+            slice.capacity = std::max({ needed, slice.capacity * 2, std::uint32_t(64) });
+            _curveData.resize(_curveData.size() + slice.capacity);
+            std::copy(_curveData.begin() + slice.first, _curveData.begin() + slice.first + slice.count, _curveData.begin() + first);
+            slice.first = first;
+            _curveDirty.emplace_back(first, first + needed);
+        }
+        for (size_t i = _uploadedCurveCount; i < curves.size(); ++i) {
+            CurveSlice& slice = _curveSlices[_store.getLayerId(curves[i].id)];
+            _curveData[slice.first + slice.count++] = curves[i];
+        }
+        _uploadedCurveCount = curves.size();
+
+        f->glBindBuffer(GL_ARRAY_BUFFER, _curveVbo);
+        if (_curveData.size() > _curveCapacity) {
+            // Grows geometrically, like the scene buffers
+            _curveCapacity = std::max(_curveData.size() + _curveData.size() / 2, size_t(1) << 10);
+            f->glBufferData(GL_ARRAY_BUFFER, _curveCapacity * sizeof(SceneStore::CurveInstance), nullptr, GL_DYNAMIC_DRAW);
+            f->glBufferSubData(GL_ARRAY_BUFFER, 0, _curveData.size() * sizeof(SceneStore::CurveInstance), _curveData.data());
+        }
+        else {
+            for (auto [begin, end] : _curveDirty) {
+                f->glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(SceneStore::CurveInstance),
+                    (end - begin) * sizeof(SceneStore::CurveInstance), _curveData.data() + begin);
+            }
+        }
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    const float pixelSize = static_cast<float>(1.0 / _camera.getScale());
+    if (pick) {
+        f->glUseProgram(_pickCurveProgram);
+        f->glUniformMatrix4fv(_uniforms.pickCurveProjection, 1, GL_FALSE, &viewProj[0][0]);
+        f->glUniform1f(_uniforms.pickCurvePixelSize, pixelSize);
+    }
+    else {
+        f->glUseProgram(_curveProgram);
+        f->glUniformMatrix4fv(_uniforms.curveProjection, 1, GL_FALSE, &viewProj[0][0]);
+        f->glUniform1f(_uniforms.curvePixelSize, pixelSize);
+    }
+    f->glBindVertexArray(_curveVao);
+
+    if (!culled) {
+        for (LayerTable::LayerId layer = 0; layer < _curveSlices.size(); ++layer) {
+            const std::uint32_t count = _curveSlices[layer].count;
+            if (count == 0 || !layers.get(layer).isDrawn()) continue;
+            setCurveInstances(f, _curveVbo, _curveSlices[layer].first);
+            f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(count));
+            _frameStats.countDraw(4 * std::uint64_t(count));
+        }
+    }
+    else {
+        // The visible ones were found by the tile grid for the line pass
+        {
+            FrameStats::Timer timer(_frameStats, FrameStats::Cull);
+            _visibleCurves.clear();
+            for (SceneStore::EntityId id : _visibleIds) {
+                if (_store.isCurve(id) && layers.get(_store.getLayerId(id)).isDrawn())
+                    _visibleCurves.push_back(_store.getCurve(id));
+            }
+        }
+        if (!_visibleCurves.empty()) {
+            f->glBindBuffer(GL_ARRAY_BUFFER, _curveStreamVbo);
+            f->glBufferData(GL_ARRAY_BUFFER, _visibleCurves.size() * sizeof(SceneStore::CurveInstance),
+                _visibleCurves.data(), GL_STREAM_DRAW);
+            f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+            setCurveInstances(f, _curveStreamVbo, 0);
+            f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_visibleCurves.size()));
+            _frameStats.countDraw(4 * std::uint64_t(_visibleCurves.size()));
+        }
+    }
+    f->glBindVertexArray(0);
+}
+
+void Render2D::addMarkers(const std::vector<glm::vec2>& points, const float color[3])
+{
+    if (points.empty()) return;
+    const std::uint32_t rgba = PackRgba(color);
+    if (_markerDirtyBegin == _markerDirtyEnd) _markerDirtyBegin = _markers.size();
+    _markers.reserve(_markers.size() + points.size());
+    _markerBounds.reserve(_markerBounds.size() + points.size() * 4);
+    for (const auto& p : points) {
+        _markers.push_back({ p.x, p.y, rgba });
+        _markerBounds.insert(_markerBounds.end(), { p.x, p.y, p.x, p.y });
+    }
+    _markerDirtyEnd = _markers.size();
+}
+
+void Render2D::setMarkerColor(size_t index, const float color[3])
+{
+    _markers[index].rgba = PackRgba(color);
+    if (_markerDirtyBegin == _markerDirtyEnd) {
+        _markerDirtyBegin = index;
+        _markerDirtyEnd = index + 1;
+        return;
+    }
+    _markerDirtyBegin = std::min(_markerDirtyBegin, index);
+    _markerDirtyEnd = std::max(_markerDirtyEnd, index + 1);
+}
+
+void Render2D::clearMarkers()
+{
+    // The buffer stays allocated for the next markers
+    _markers.clear();
+    _markerBounds.clear();
+    _markerTree.clear();
+    _markerTreeStale = true;
+    _markerDirtyBegin = _markerDirtyEnd = 0;
+}
+
+size_t Render2D::findMarkerAt(float worldX, float worldY, float radius)
+{
+    if (_markers.empty()) return NO_MARKER;
+    // Markers are only appended until cleared
+    if (_markerTreeStale) {
+        _markerTree.build(_markerBounds);
+        _markerTreeStale = false;
+    }
+    else {
+        _markerTree.update();
+    }
+
+    // Markers keep their size on screen, so the reach is in pixels too
+    const float pixelSize = static_cast<float>(1.0 / _camera.getScale());
+    const float reach = (radius + 0.5f * MARKER_SIZE_PX) * pixelSize;
+    std::uint32_t hit = _markerTree.nearest(worldX, worldY, reach, [&](std::uint32_t id) {
+        return std::hypot(_markers[id].x - worldX, _markers[id].y - worldY);
+    });
+    return hit != RTree::INVALID_ID ? hit : NO_MARKER;
+}
+
+void Render2D::renderMarkers(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj)
+{
+    if (_markers.empty()) return;
+
+    if (_markerVao == 0) {
+        f->glGenVertexArrays(1, &_markerVao);
+        f->glGenBuffers(1, &_markerVbo);
+        f->glBindVertexArray(_markerVao);
+        f->glBindBuffer(GL_ARRAY_BUFFER, _markerVbo);
+        f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(MarkerInstance), reinterpret_cast<void*>(offsetof(MarkerInstance, x)));
+        f->glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MarkerInstance), reinterpret_cast<void*>(offsetof(MarkerInstance, rgba)));
+        for (GLuint loc = 0; loc <= 1; ++loc) {
+            f->glEnableVertexAttribArray(loc);
+            f->glVertexAttribDivisor(loc, 1);
+        }
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        f->glBindVertexArray(0);
+        _markerCapacity = 0;
+    }
+
+    if (_markerDirtyBegin < _markerDirtyEnd) {
+        FrameStats::Timer timer(_frameStats, FrameStats::Upload);
+        f->glBindBuffer(GL_ARRAY_BUFFER, _markerVbo);
+        if (_markers.size() > _markerCapacity) {
+            // Grows geometrically, like the style buffer
+            _markerCapacity = std::max(_markers.size(), _markerCapacity * 2);
+            f->glBufferData(GL_ARRAY_BUFFER, _markerCapacity * sizeof(MarkerInstance), nullptr, GL_DYNAMIC_DRAW);
+            _markerDirtyBegin = 0;
+        }
+        f->glBufferSubData(GL_ARRAY_BUFFER, _markerDirtyBegin * sizeof(MarkerInstance),
+            (_markerDirtyEnd - _markerDirtyBegin) * sizeof(MarkerInstance), &_markers[_markerDirtyBegin]);
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        _markerDirtyBegin = _markerDirtyEnd = 0;
+    }
+
+    f->glUseProgram(_markerProgram);
+    f->glUniformMatrix4fv(_uniforms.markerProjection, 1, GL_FALSE, &viewProj[0][0]);
+    f->glUniform2f(_uniforms.markerViewport, static_cast<float>(_width), static_cast<float>(_height));
+    f->glUniform1f(_uniforms.markerSize, MARKER_SIZE_PX);
+    f->glBindVertexArray(_markerVao);
+    f->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(_markers.size()));
+    _frameStats.countDraw(4 * std::uint64_t(_markers.size()));
+    f->glBindVertexArray(0);
+}
+
+void Render2D::setBlockInstances(QOpenGLFunctions_3_3_Core* f, GLuint buffer, size_t firstInstance)
+{
+    const GLsizei stride = sizeof(InstanceData);
+    const size_t base = firstInstance * sizeof(InstanceData);
+    f->glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(base + offsetof(InstanceData, row0)));
+    f->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(base + offsetof(InstanceData, row1)));
+    f->glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, stride, reinterpret_cast<void*>(base + offsetof(InstanceData, id)));
+    f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Render2D::uploadBlockBatch(QOpenGLFunctions_3_3_Core* f, BlockBatch& batch)
+{
+    if (batch.vao == 0) {
+        const auto& verts = batch.block->getVertices();
+
+        f->glGenVertexArrays(1, &batch.vao);
+        f->glGenBuffers(1, &batch.geometryVbo);
+        f->glGenBuffers(1, &batch.instanceVbo);
+        f->glBindVertexArray(batch.vao);
+
+        // Shared block geometry
+        f->glBindBuffer(GL_ARRAY_BUFFER, batch.geometryVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+        f->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), reinterpret_cast<void*>(0));
+        f->glEnableVertexAttribArray(0);
+
+        // Per instance transform and entity id
+        setBlockInstances(f, batch.instanceVbo, 0);
+        for (GLuint loc = 1; loc <= 3; ++loc) {
+            f->glEnableVertexAttribArray(loc);
+            f->glVertexAttribDivisor(loc, 1);
+        }
+
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        f->glBindVertexArray(0);
+    }
+    else if (batch.geometryDirty) {
+        const auto& verts = batch.block->getVertices();
+        f->glBindBuffer(GL_ARRAY_BUFFER, batch.geometryVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_STATIC_DRAW);
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    batch.geometryDirty = false;
+
+    if (batch.instancesDirty) {
+        std::vector<InstanceData> data;
+        data.reserve(batch.instances.size());
+        for (SceneStore::EntityId id : batch.instances)
+            data.push_back(instanceOf(id));
+        f->glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(InstanceData), data.data(), GL_DYNAMIC_DRAW);
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        batch.instancesDirty = false;
+    }
+}
+
+Render2D::InstanceData Render2D::instanceOf(SceneStore::EntityId id) const
+{
+    const glm::mat3& m = static_cast<const Insert*>(_entities[id].get())->getTransform();
+    return {
+        { m[0][0], m[1][0], m[2][0] },
+        { m[0][1], m[1][1], m[2][1] },
+        id };
+}
+
+void Render2D::renderBlocks(QOpenGLFunctions_3_3_Core* f, const glm::mat4& viewProj, bool culled, bool pick)
+{
+    if (_blockBatches.empty()) return;
+    const LayerTable& layers = _store.getLayers();
+
+    if (culled) {
+        // The visible ones were found by the tile grid for the line pass
+        FrameStats::Timer timer(_frameStats, FrameStats::Cull);
+        for (auto& [key, batch] : _blockBatches)
+            batch.visible.clear();
+        for (SceneStore::EntityId id : _visibleIds) {
+            if (_store.getKind(id) != SceneStore::Kind::Insert) continue;
+            auto slot = _insertSlots.find(id);
+            if (slot != _insertSlots.end() && layers.get(slot->second.first->layer).isDrawn())
+                slot->second.first->visible.push_back(id);
+        }
+    }
+
+    if (pick) {
+        f->glUseProgram(_pickInstanceProgram);
+        f->glUniformMatrix4fv(_uniforms.pickInstanceProjection, 1, GL_FALSE, &viewProj[0][0]);
+    }
+    else {
+        f->glUseProgram(_instanceProgram);
+        f->glUniformMatrix4fv(_uniforms.instanceProjection, 1, GL_FALSE, &viewProj[0][0]);
+    }
+
+    // Zoomed in, the visible instances of all batches go up in one stream
+    if (culled) {
+        _visibleInstances.clear();
+        for (auto& [key, batch] : _blockBatches) {
+            for (SceneStore::EntityId id : batch.visible)
+                _visibleInstances.push_back(instanceOf(id));
+        }
+        if (_visibleInstances.empty()) return;
+        if (_blockStreamVbo == 0) f->glGenBuffers(1, &_blockStreamVbo);
+        f->glBindBuffer(GL_ARRAY_BUFFER, _blockStreamVbo);
+        f->glBufferData(GL_ARRAY_BUFFER, _visibleInstances.size() * sizeof(InstanceData),
+            _visibleInstances.data(), GL_STREAM_DRAW);
+        f->glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    size_t streamNext = 0;
+    for (auto& [key, batch] : _blockBatches) {
+        const size_t streamFirst = streamNext;
+        if (culled) streamNext += batch.visible.size();
+        if (batch.instances.empty() || batch.block->getRanges().empty()) continue;
+        if (!layers.get(batch.layer).isDrawn()) continue;
+        GLsizei instanceCount = static_cast<GLsizei>(culled ? batch.visible.size() : batch.instances.size());
+        if (instanceCount == 0) continue;
+        uploadBlockBatch(f, batch);
+
+        f->glBindVertexArray(batch.vao);
+        if (culled) setBlockInstances(f, _blockStreamVbo, streamFirst);
+        for (const auto& range : batch.block->getRanges()) {
+            if (!pick) f->glUniform3fv(_uniforms.instanceColor, 1, range.color);
+            f->glDrawArraysInstanced(glMode(range.mode), range.first, range.count, instanceCount);
+            _frameStats.countDraw(std::uint64_t(range.count) * instanceCount);
+        }
+        // The batch's own buffer stays the default for whole-scene and overlay draws
+        if (culled) setBlockInstances(f, batch.instanceVbo, 0);
+    }
+    f->glBindVertexArray(0);
 }
 
 void Render2D::resize(int width, int height, QOpenGLFunctions_3_3_Core* f)
@@ -120,6 +1251,80 @@ void Render2D::handleZoom(float delta, double mouseX, double mouseY)
     _camera.zoomAt(factor, worldPos);
 }
 
+bool Render2D::drawsAnalytically(const Entity& entity)
+{
+    float cx, cy, radius, startAngle, sweep;
+    return entity.getCircularArc(cx, cy, radius, startAngle, sweep);
+}
+
+static void CollectBlockScales(const std::vector<std::shared_ptr<Entity>>& entities, float scale,
+    std::unordered_map<BlockDefinition*, float>& scales, int depth)
+{
+    if (depth > 32) return; // self-referencing blocks
+    for (const auto& entity : entities) {
+        const auto* insert = dynamic_cast<const Insert*>(entity.get());
+        if (!insert || !insert->getBlock()) continue;
+        const glm::mat3& m = insert->getTransform();
+        float blockScale = scale * std::max(glm::length(glm::vec2(m[0])), glm::length(glm::vec2(m[1])));
+        BlockDefinition* block = insert->getBlock().get();
+        auto [it, added] = scales.emplace(block, blockScale);
+        if (!added && it->second >= blockScale) continue;
+        it->second = blockScale;
+        CollectBlockScales(block->getEntities(), blockScale, scales, depth + 1);
+    }
+}
+
+std::unordered_map<BlockDefinition*, float> Render2D::getBlockScales(const std::vector<std::shared_ptr<Entity>>& entities)
+{
+    std::unordered_map<BlockDefinition*, float> scales;
+    CollectBlockScales(entities, 1.0f, scales, 0);
+    return scales;
+}
+
+int Render2D::getLodLevel() const
+{
+    return getLodLevelForScale(_camera.getScale());
+}
+
+int Render2D::getLodLevelForScale(double scale)
+{
+    int level = static_cast<int>(std::ceil(std::log2(std::max(scale, 1e-9))));
+    return std::clamp(level, MIN_LOD_LEVEL, MAX_LOD_LEVEL);
+}
+
+bool Render2D::getSceneBounds(float bounds[4]) const
+{
+    const auto& all = _store.getAllBounds();
+    bool any = false;
+    for (size_t i = 0; i + 3 < all.size(); i += 4) {
+        const float* b = &all[i];
+        if (b[0] > b[2] || b[1] > b[3]) continue; // no geometry
+        if (!any) {
+            std::copy(b, b + 4, bounds);
+            any = true;
+            continue;
+        }
+        bounds[0] = std::min(bounds[0], b[0]);
+        bounds[1] = std::min(bounds[1], b[1]);
+        bounds[2] = std::max(bounds[2], b[2]);
+        bounds[3] = std::max(bounds[3], b[3]);
+    }
+    return any;
+}
+
+bool Render2D::zoomToExtents(float margin)
+{
+    float bounds[4];
+    if (!getSceneBounds(bounds)) return false;
+    _camera.fitRect(bounds, margin);
+    return true;
+}
+
+float Render2D::getChordTolerance(int lodLevel)
+{
+    return CHORD_TOLERANCE_PX / std::ldexp(1.0f, lodLevel);
+}
+
 GLuint Render2D::compileShader(QOpenGLFunctions_3_3_Core* f, GLenum type, const char* source)
 {
     GLuint shader = f->glCreateShader(type);
@@ -179,34 +1384,276 @@ glm::vec2 Render2D::getMouseWorldPos(const QPoint& mousePos)
     return (glm::vec2(worldPosInPixels.x, worldPosInPixels.y) - _camera.getOffset()) / static_cast<float>(_camera.getScale());
 }
 
-Entity* Render2D::findEntityAtPoint(float worldX, float worldY, float tolerance) const
+void Render2D::syncSpatialIndex()
 {
-	// reversed order to find topmost entity first
-    for (auto it = _entities.rbegin(); it != _entities.rend(); it++) 
-    {
-		if ((*it)->hitTest(worldX, worldY, tolerance))
-		{
-			return it->get();
-		}
+    // New entities are only appended; changed vertices can move any box
+    if (_spatialIndexStale) {
+        _rtree.build(_store.getAllBounds());
+        _spatialIndexStale = false;
+    }
+    else {
+        _rtree.update();
+    }
+}
+
+Entity* Render2D::findEntityAtPoint(float worldX, float worldY, float tolerance)
+{
+    syncSpatialIndex();
+    const LayerTable& layers = _store.getLayers();
+    SceneStore::EntityId hit = _rtree.nearest(worldX, worldY, tolerance, [&](SceneStore::EntityId id) {
+        if (!layers.get(_store.getLayerId(id)).isDrawn()) return -1.0f;
+        // Polylines answer from their cached segment tree instead of every drawn segment
+        if (_store.getKind(id) == SceneStore::Kind::Polyline)
+            return static_cast<const Polyline*>(_entities[id].get())->distanceTo(worldX, worldY, tolerance);
+        float distance = _store.distanceTo(id, worldX, worldY);
+        if (distance >= 0.0f) return distance;
+        // Inserts only answer hit or miss; a hit ranks behind any closer geometry
+        return _entities[id]->hitTest(worldX, worldY, tolerance) ? tolerance : -1.0f;
+    });
+    return hit != RTree::INVALID_ID ? _entities[hit].get() : nullptr;
+}
+
+void Render2D::queryEntityIds(float minX, float minY, float maxX, float maxY, std::vector<SceneStore::EntityId>& ids)
+{
+    syncSpatialIndex();
+    _rtree.query(minX, minY, maxX, maxY, ids);
+    std::sort(ids.begin(), ids.end());
+}
+
+std::vector<Entity*> Render2D::findEntitiesInRect(float minX, float minY, float maxX, float maxY, bool crossing)
+{
+    syncSpatialIndex();
+    std::vector<SceneStore::EntityId> ids;
+    if (crossing)
+        _rtree.query(minX, minY, maxX, maxY, ids);
+    else
+        _rtree.queryContained(minX, minY, maxX, maxY, ids);
+    std::sort(ids.begin(), ids.end());
+
+    const LayerTable& layers = _store.getLayers();
+    const float rect[4] = { minX, minY, maxX, maxY };
+    std::vector<Entity*> result;
+    for (SceneStore::EntityId id : ids) {
+        if (!layers.get(_store.getLayerId(id)).isDrawn()) continue;
+        // A box overlap is enough for inserts, the rest must really touch the rectangle
+        if (crossing && _store.touchesRect(id, rect) == 0) continue;
+        result.push_back(_entities[id].get());
+    }
+    return result;
+}
+
+void Render2D::updatePickBuffer(QOpenGLFunctions_3_3_Core* f)
+{
+    glm::mat4 viewProj = _camera.getMatrix();
+    syncSceneBuffer(f);
+    if (_pickValid && _pickWidth == _width && _pickHeight == _height
+        && _pickGeometryVersion == _store.getGeometryVersion()
+        && _pickAppearanceVersion == _appearanceVersion && _pickViewProj == viewProj)
+        return;
+
+    GLint previous = 0;
+    f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+
+    if (_pickFbo == 0) {
+        f->glGenFramebuffers(1, &_pickFbo);
+        f->glGenTextures(1, &_pickTexture);
+        _pickWidth = _pickHeight = 0;
+    }
+    f->glBindFramebuffer(GL_FRAMEBUFFER, _pickFbo);
+    if (_pickWidth != _width || _pickHeight != _height) {
+        f->glBindTexture(GL_TEXTURE_2D, _pickTexture);
+        f->glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, _width, _height, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        f->glBindTexture(GL_TEXTURE_2D, 0);
+        f->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _pickTexture, 0);
+        _pickWidth = _width;
+        _pickHeight = _height;
+    }
+
+    // Same primitives and culling as the visible frame, ids instead of colors
+    const GLuint background[4] = { 0, 0, 0, 0 };
+    f->glClearBufferuiv(GL_COLOR, 0, background);
+    f->glDisable(GL_BLEND);
+    f->glActiveTexture(GL_TEXTURE1);
+    f->glBindTexture(GL_TEXTURE_BUFFER, _stateTexture);
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_BUFFER, _styleTexture);
+
+    f->glUseProgram(_pickSceneProgram);
+    f->glUniformMatrix4fv(_uniforms.pickSceneProjection, 1, GL_FALSE, &viewProj[0][0]);
+    bool culled = drawSceneLines(f);
+    renderCurves(f, viewProj, culled, true);
+    renderBlocks(f, viewProj, culled, true);
+
+    f->glBindTexture(GL_TEXTURE_BUFFER, 0);
+    f->glEnable(GL_BLEND);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous));
+
+    _pickViewProj = viewProj;
+    _pickGeometryVersion = _store.getGeometryVersion();
+    _pickAppearanceVersion = _appearanceVersion;
+    _pickValid = true;
+}
+
+Entity* Render2D::pickEntity(QOpenGLFunctions_3_3_Core* f, const QPoint& pos, int radius)
+{
+    if (_width <= 0 || _height <= 0 || _entities.empty()) return nullptr;
+    updatePickBuffer(f);
+
+    // Window coordinates start at the bottom
+    const int cx = pos.x();
+    const int cy = _height - 1 - pos.y();
+    const int x0 = std::max(cx - radius, 0), x1 = std::min(cx + radius, _width - 1);
+    const int y0 = std::max(cy - radius, 0), y1 = std::min(cy + radius, _height - 1);
+    if (x0 > x1 || y0 > y1) return nullptr;
+    const int w = x1 - x0 + 1, h = y1 - y0 + 1;
+
+    _pickPixels.resize(static_cast<size_t>(w) * h);
+    GLint previous = 0;
+    f->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    f->glBindFramebuffer(GL_FRAMEBUFFER, _pickFbo);
+    f->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    f->glReadPixels(x0, y0, w, h, GL_RED_INTEGER, GL_UNSIGNED_INT, _pickPixels.data());
+    f->glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previous));
+
+    // The nearest covered pixel wins; entities tied at that distance are
+    // told apart by their exact geometry
+    int best = radius * radius + 1;
+    std::vector<SceneStore::EntityId> tied;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            std::uint32_t value = _pickPixels[static_cast<size_t>(y) * w + x];
+            if (value == 0 || value > _entities.size()) continue;
+            int dx = x0 + x - cx, dy = y0 + y - cy;
+            int d = dx * dx + dy * dy;
+            if (d > best) continue;
+            if (d < best) {
+                best = d;
+                tied.clear();
+            }
+            SceneStore::EntityId id = value - 1;
+            if (std::find(tied.begin(), tied.end(), id) == tied.end())
+                tied.push_back(id);
+        }
     }
-	return nullptr;
+    if (tied.empty()) return nullptr;
+    if (tied.size() == 1) return _entities[tied[0]].get();
+
+    // Topmost first, like the draw order
+    std::sort(tied.begin(), tied.end(), std::greater<SceneStore::EntityId>());
+    glm::vec2 world = getMouseWorldPos(pos);
+    float tolerance = static_cast<float>((std::sqrt(static_cast<double>(best)) + 0.5) / _camera.getScale());
+    for (SceneStore::EntityId id : tied) {
+        if (_entities[id]->hitTest(world.x, world.y, tolerance))
+            return _entities[id].get();
+    }
+    return _entities[tied[0]].get();
 }
 
 void Render2D::clearEntities(QOpenGLFunctions_3_3_Core* f) {
-    for (auto& entity : _entities) {
-        entity->deleteBuffers(f); // Free OpenGL resources
+    // Free OpenGL resources
+    if (_sceneVao != 0) {
+        GLuint buffers[4] = { _sceneVbo, _sceneOwnerVbo, _styleBuffer, _stateBuffer };
+        f->glDeleteBuffers(4, buffers);
+        f->glDeleteVertexArrays(1, &_sceneVao);
+        GLuint textures[2] = { _styleTexture, _stateTexture };
+        f->glDeleteTextures(2, textures);
+        _sceneVao = _sceneVbo = _sceneOwnerVbo = _styleBuffer = _styleTexture = 0;
+        _stateBuffer = _stateTexture = 0;
+        _sceneVboCapacity = 0;
+        _styleCapacity = 0;
+        _stateCapacity = 0;
+    }
+    if (_curveVao != 0) {
+        GLuint buffers[3] = { _curveQuadVbo, _curveVbo, _curveStreamVbo };
+        f->glDeleteBuffers(3, buffers);
+        f->glDeleteVertexArrays(1, &_curveVao);
+        _curveVao = _curveQuadVbo = _curveVbo = _curveStreamVbo = 0;
+    }
+    if (_markerVao != 0) {
+        f->glDeleteBuffers(1, &_markerVbo);
+        f->glDeleteVertexArrays(1, &_markerVao);
+        _markerVao = _markerVbo = 0;
+        _markerCapacity = 0;
+    }
+    clearMarkers();
+    if (_pickFbo != 0) {
+        f->glDeleteFramebuffers(1, &_pickFbo);
+        f->glDeleteTextures(1, &_pickTexture);
+        _pickFbo = _pickTexture = 0;
+    }
+    _pickValid = false;
+    if (_sceneCacheFbo != 0) {
+        f->glDeleteFramebuffers(1, &_sceneCacheFbo);
+        f->glDeleteTextures(1, &_sceneCacheTexture);
+        f->glDeleteVertexArrays(1, &_compositeVao);
+        _sceneCacheFbo = _sceneCacheTexture = _compositeVao = 0;
     }
+    _sceneCacheValid = false;
+    _insertSlots.clear();
+    _uploadedCurveCount = 0;
+    _curveCapacity = 0;
+    _curveSlices.clear();
+    _curveData.clear();
+    _dimAll = false;
+    _styleData.clear();
+    _store.clear();
+    _grid.clear();
+    _gridStale = true;
+    _rtree.clear();
+    _spatialIndexStale = true;
+    _entityIndex.clear();
     _entities.clear();
+
+    for (auto& [key, batch] : _blockBatches) {
+        if (batch.vao == 0) continue;
+        GLuint buffers[2] = { batch.geometryVbo, batch.instanceVbo };
+        f->glDeleteBuffers(2, buffers);
+        f->glDeleteVertexArrays(1, &batch.vao);
+    }
+    _blockBatches.clear();
+    if (_blockStreamVbo != 0) {
+        f->glDeleteBuffers(1, &_blockStreamVbo);
+        _blockStreamVbo = 0;
+    }
+    _visibleInstances.clear();
 }
 
 void Render2D::hightlightEntity(Entity* selectedEntity)
 {
-	for (auto& entity : _entities) {
-		if (selectedEntity == nullptr || entity.get() == selectedEntity) {
-			entity->setAlpha(1.0);
-		}
-		else {
-            entity->setAlpha(0.2);
-		}
-	}
+    _store.clearSelection();
+    _dimAll = false;
+    if (!selectedEntity) return;
+
+    auto it = _entityIndex.find(selectedEntity);
+    if (it != _entityIndex.end())
+        _store.setSelected(it->second, true);
+    else
+        _dimAll = true;     // An entity that is not in this scene dims everything
+}
+
+void Render2D::setEntitySelected(Entity* entity, bool selected)
+{
+    auto it = _entityIndex.find(entity);
+    if (it != _entityIndex.end())
+        _store.setSelected(it->second, selected);
+}
+
+bool Render2D::isEntitySelected(Entity* entity) const
+{
+    auto it = _entityIndex.find(entity);
+    return it != _entityIndex.end() && (_store.getState(it->second) & SceneStore::Selected) != 0;
+}
+
+void Render2D::clearSelection()
+{
+    _store.clearSelection();
+    _dimAll = false;
+}
+
+void Render2D::setHoveredEntity(Entity* entity)
+{
+    auto it = entity ? _entityIndex.find(entity) : _entityIndex.end();
+    _store.setHovered(it != _entityIndex.end() ? it->second : SceneStore::INVALID_ID);
 }
@@ -0,0 +1,568 @@
+#include "SceneCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include "Entities/Line.h"
+#include "Entities/Circle.h"
+#include "Entities/Arc.h"
+#include "Entities/Polyline.h"
+#include "Entities/Insert.h"
+#include "MemoryStats.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (_file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) return;
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping) return;
+        _data = static_cast<const unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (_data) _size = static_cast<size_t>(size.QuadPart);
+#else
+        _fd = ::open(path.c_str(), O_RDONLY);
+        if (_fd < 0) return;
+        struct stat st;
+        if (::fstat(_fd, &st) != 0 || st.st_size == 0) return;
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (p == MAP_FAILED) return;
+        _data = static_cast<const unsigned char*>(p);
+        _size = static_cast<size_t>(st.st_size);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (_data) UnmapViewOfFile(_data);
+        if (_mapping) CloseHandle(_mapping);
+        if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+#else
+        if (_data) ::munmap(const_cast<unsigned char*>(_data), _size);
+        if (_fd >= 0) ::close(_fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool isOpen() const { return _data != nullptr; }
+
+private:
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _fd = -1;
+#endif
+    const unsigned char* _data = nullptr;
+    size_t _size = 0;
+};
+
+enum class CachedType : std::uint32_t { Line = 0, Circle = 1, Arc = 2, Polyline = 3, Insert = 4 };
+
+constexpr char kMagic[8] = { 'D', 'X', 'F', 'S', 'C', 'E', 'N', 'E' };
+
+struct CacheHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t sourceSize;
+    std::uint64_t sourceHash;
+    std::uint64_t layerCount;       // CacheLayer records
+    std::uint64_t layerOffset;
+    std::uint64_t stringOffset;     // layer, record type and block names blob
+    std::uint64_t stringSize;
+    std::uint64_t skippedCount;     // records the loader skipped
+    std::uint64_t skippedTypeCount; // CacheSkipped records
+    std::uint64_t skippedTypeOffset;
+    std::uint64_t blockCount;       // CacheBlock records
+    std::uint64_t blockOffset;
+    std::uint64_t modelCount;       // leading entity records that are in model space
+    std::uint64_t entityCount;      // CacheEntity records
+    std::uint64_t entityOffset;
+    std::uint64_t bulgeCount;       // CacheBulge records
+    std::uint64_t bulgeOffset;
+    std::uint64_t vertexCount;      // x,y float pairs
+    std::uint64_t vertexOffset;
+};
+
+struct CacheLayer
+{
+    std::uint64_t nameOffset;       // into the string blob
+    std::uint64_t nameLength;
+    float color[3];
+    std::uint32_t flags;            // kLayerHidden | kLayerFrozen
+};
+
+constexpr std::uint32_t kLayerHidden = 1;
+constexpr std::uint32_t kLayerFrozen = 2;
+
+struct CacheSkipped
+{
+    std::uint64_t nameOffset;       // record type, into the string blob
+    std::uint64_t nameLength;
+    std::uint64_t count;
+};
+
+struct CacheBlock
+{
+    std::uint64_t nameOffset;       // into the string blob
+    std::uint64_t nameLength;
+    float basePoint[2];
+    std::uint64_t entityFirst;      // member records
+    std::uint64_t entityCount;
+};
+
+struct CacheEntity
+{
+    std::uint32_t type;             // CachedType
+    std::uint32_t layer;            // index into the layer records
+    float color[3];
+    std::uint32_t closed;
+    std::uint32_t block;            // insert: index into the block records
+    float params[6];                // circle/arc: cx, cy, radius, start angle, end angle
+                                    // insert: transform columns x, y and translation
+    std::uint32_t reserved;
+    std::uint64_t vertexFirst;      // in vertices, not floats
+    std::uint64_t vertexCount;
+    std::uint64_t bulgeFirst;
+    std::uint64_t bulgeCount;
+};
+
+struct CacheBulge
+{
+    float x, y, bulge;
+};
+
+static_assert(sizeof(CacheHeader) == 160, "cache layout changed, bump SceneCache::VERSION");
+static_assert(sizeof(CacheLayer) == 32, "cache layout changed, bump SceneCache::VERSION");
+static_assert(sizeof(CacheSkipped) == 24, "cache layout changed, bump SceneCache::VERSION");
+static_assert(sizeof(CacheBlock) == 40, "cache layout changed, bump SceneCache::VERSION");
+static_assert(sizeof(CacheEntity) == 88, "cache layout changed, bump SceneCache::VERSION");
+
+std::uint64_t Align8(std::uint64_t v) { return (v + 7) & ~std::uint64_t(7); }
+
+// 64-bit FNV-1a over 8-byte words; only needs to tell revisions of a file apart
+std::uint64_t HashBytes(const unsigned char* data, size_t size)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    const std::uint64_t prime = 1099511628211ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash;
+}
+
+bool HashSource(const std::string& dxfPath, std::uint64_t& size, std::uint64_t& hash)
+{
+    MappedFile source(dxfPath);
+    if (!source.isOpen()) return false;
+    size = source.size();
+    hash = HashBytes(source.data(), source.size());
+    return true;
+}
+
+CachedType TypeOf(const Entity* entity, bool& supported)
+{
+    supported = true;
+    if (dynamic_cast<const Insert*>(entity)) return CachedType::Insert;
+    if (dynamic_cast<const Polyline*>(entity)) return CachedType::Polyline;
+    if (dynamic_cast<const Arc*>(entity)) return CachedType::Arc;
+    if (dynamic_cast<const Circle*>(entity)) return CachedType::Circle;
+    if (dynamic_cast<const Line*>(entity)) return CachedType::Line;
+    supported = false;
+    return CachedType::Line;
+}
+
+// Record names match the ones DxfLoader puts in the report
+const char* RecordName(CachedType type)
+{
+    switch (type) {
+    case CachedType::Line: return "LINE";
+    case CachedType::Circle: return "CIRCLE";
+    case CachedType::Arc: return "ARC";
+    case CachedType::Polyline: return "LWPOLYLINE";
+    case CachedType::Insert: return "INSERT";
+    }
+    return "";
+}
+
+} // namespace
+
+std::string SceneCache::cachePathFor(const std::string& dxfPath)
+{
+    return dxfPath + ".dxfcache";
+}
+
+bool SceneCache::load(const std::string& dxfPath,
+    std::vector<std::shared_ptr<Entity>>& entities, LayerTable& layers, DxfLoadReport& report)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    MappedFile cache(cachePathFor(dxfPath));
+    if (!cache.isOpen() || cache.size() < sizeof(CacheHeader))
+        return false;
+
+    CacheHeader header;
+    std::memcpy(&header, cache.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != VERSION)
+        return false;
+
+    std::uint64_t sourceSize = 0, sourceHash = 0;
+    if (!HashSource(dxfPath, sourceSize, sourceHash))
+        return false;
+    if (sourceSize != header.sourceSize || sourceHash != header.sourceHash)
+        return false;
+
+    // Every section must lie inside the mapping
+    auto fits = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t stride) {
+        return offset <= cache.size() && count <= (cache.size() - offset) / stride;
+    };
+    if (!fits(header.layerOffset, header.layerCount, sizeof(CacheLayer)) ||
+        !fits(header.stringOffset, header.stringSize, 1) ||
+        !fits(header.skippedTypeOffset, header.skippedTypeCount, sizeof(CacheSkipped)) ||
+        !fits(header.blockOffset, header.blockCount, sizeof(CacheBlock)) ||
+        !fits(header.entityOffset, header.entityCount, sizeof(CacheEntity)) ||
+        !fits(header.bulgeOffset, header.bulgeCount, sizeof(CacheBulge)) ||
+        !fits(header.vertexOffset, header.vertexCount, 2 * sizeof(float)) ||
+        header.modelCount > header.entityCount)
+        return false;
+
+    const unsigned char* base = cache.data();
+    const auto* layerRecords = reinterpret_cast<const CacheLayer*>(base + header.layerOffset);
+    const char* strings = reinterpret_cast<const char*>(base + header.stringOffset);
+    const auto* skippedRecords = reinterpret_cast<const CacheSkipped*>(base + header.skippedTypeOffset);
+    const auto* blockRecords = reinterpret_cast<const CacheBlock*>(base + header.blockOffset);
+    const auto* records = reinterpret_cast<const CacheEntity*>(base + header.entityOffset);
+    const auto* bulges = reinterpret_cast<const CacheBulge*>(base + header.bulgeOffset);
+    const auto* pool = reinterpret_cast<const float*>(base + header.vertexOffset);
+
+    LayerTable layerTable;
+    std::vector<std::shared_ptr<const std::string>> layerNames;
+    layerNames.reserve(header.layerCount);
+    auto inStrings = [&](std::uint64_t offset, std::uint64_t length) {
+        return offset <= header.stringSize && length <= header.stringSize - offset;
+    };
+    for (std::uint64_t i = 0; i < header.layerCount; ++i) {
+        const CacheLayer& rec = layerRecords[i];
+        if (!inStrings(rec.nameOffset, rec.nameLength))
+            return false;
+        LayerTable::LayerId id = layerTable.intern(std::string(strings + rec.nameOffset, rec.nameLength));
+        LayerInfo& layer = layerTable.get(id);
+        std::memcpy(layer.color, rec.color, sizeof(layer.color));
+        layer.visible = (rec.flags & kLayerHidden) == 0;
+        layer.frozen = (rec.flags & kLayerFrozen) != 0;
+        layerNames.push_back(layerTable.getSharedName(id));
+    }
+
+    const std::uint64_t allocationsBefore = MemoryStats::threadAllocationCount();
+    auto arena = std::make_shared<DocumentArena>();
+
+    // Definitions first, so inserts can refer to them by index
+    std::vector<std::shared_ptr<BlockDefinition>> blocks;
+    blocks.reserve(header.blockCount);
+    for (std::uint64_t i = 0; i < header.blockCount; ++i) {
+        const CacheBlock& rec = blockRecords[i];
+        if (!inStrings(rec.nameOffset, rec.nameLength) ||
+            rec.entityFirst < header.modelCount || rec.entityFirst > header.entityCount ||
+            rec.entityCount > header.entityCount - rec.entityFirst)
+            return false;
+        auto block = std::make_shared<BlockDefinition>(std::string(strings + rec.nameOffset, rec.nameLength));
+        block->setBasePoint(glm::vec2(rec.basePoint[0], rec.basePoint[1]));
+        blocks.push_back(std::move(block));
+    }
+
+    std::vector<std::shared_ptr<Entity>> result;
+    result.reserve(header.entityCount);
+    DxfLoadReport cachedReport;
+    cachedReport.fromCache = true;
+    cachedReport.skippedCount = header.skippedCount;
+    for (std::uint64_t i = 0; i < header.skippedTypeCount; ++i) {
+        const CacheSkipped& rec = skippedRecords[i];
+        if (!inStrings(rec.nameOffset, rec.nameLength))
+            return false;
+        cachedReport.skippedByType[std::string(strings + rec.nameOffset, rec.nameLength)] = rec.count;
+    }
+
+    for (std::uint64_t i = 0; i < header.entityCount; ++i) {
+        const CacheEntity& rec = records[i];
+        if (rec.layer >= layerNames.size() ||
+            rec.vertexFirst > header.vertexCount || rec.vertexCount > header.vertexCount - rec.vertexFirst ||
+            rec.bulgeFirst > header.bulgeCount || rec.bulgeCount > header.bulgeCount - rec.bulgeFirst)
+            return false;
+
+        const float* first = pool + rec.vertexFirst * 2;
+        std::vector<float> verts(first, first + rec.vertexCount * 2);
+
+        std::shared_ptr<Entity> entity;
+        switch (static_cast<CachedType>(rec.type)) {
+        case CachedType::Line: entity = DocumentArena::make<Line>(arena); break;
+        case CachedType::Circle:
+            entity = DocumentArena::make<Circle>(arena, rec.params[0], rec.params[1], rec.params[2], std::vector<float>());
+            break;
+        case CachedType::Arc:
+            entity = DocumentArena::make<Arc>(arena, rec.params[0], rec.params[1], rec.params[2],
+                rec.params[3], rec.params[4], std::vector<float>());
+            break;
+        case CachedType::Polyline: {
+            std::vector<PolylineVertex> plyVerts;
+            plyVerts.reserve(rec.bulgeCount);
+            for (std::uint64_t b = rec.bulgeFirst; b < rec.bulgeFirst + rec.bulgeCount; ++b) {
+                plyVerts.emplace_back(bulges[b].x, bulges[b].y, bulges[b].bulge);
+            }
+            entity = DocumentArena::make<Polyline>(arena, std::move(plyVerts), rec.closed != 0, std::vector<float>());
+            break;
+        }
+        case CachedType::Insert: {
+            if (rec.block >= blocks.size()) return false;
+            glm::mat3 transform(1.0f);
+            transform[0] = glm::vec3(rec.params[0], rec.params[1], 0.0f);
+            transform[1] = glm::vec3(rec.params[2], rec.params[3], 0.0f);
+            transform[2] = glm::vec3(rec.params[4], rec.params[5], 1.0f);
+            entity = DocumentArena::make<Insert>(arena, blocks[rec.block], transform);
+            break;
+        }
+        default:
+            return false;
+        }
+        entity->setVertices(std::move(verts));
+        entity->setColor(rec.color[0], rec.color[1], rec.color[2]);
+        entity->setLayer(layerNames[rec.layer]);
+
+        ++cachedReport.entitiesByType[RecordName(static_cast<CachedType>(rec.type))];
+        ++cachedReport.entitiesByLayer[*layerNames[rec.layer]];
+        ++cachedReport.entityCount;
+        cachedReport.vertexCount += rec.vertexCount;
+        result.push_back(std::move(entity));
+    }
+
+    // Hand the members to their blocks and flatten them from the cached vertices
+    for (std::uint64_t i = 0; i < header.blockCount; ++i) {
+        const CacheBlock& rec = blockRecords[i];
+        for (std::uint64_t e = rec.entityFirst; e < rec.entityFirst + rec.entityCount; ++e) {
+            blocks[i]->addEntity(result[e]);
+        }
+    }
+    for (const auto& block : blocks) {
+        block->build();
+    }
+    result.resize(header.modelCount);
+
+    cachedReport.allocationCount = MemoryStats::threadAllocationCount() - allocationsBefore;
+    cachedReport.arenaBytes = arena->getBytesAllocated();
+    cachedReport.peakRssBytes = MemoryStats::peakResidentBytes();
+    cachedReport.parseMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    entities = std::move(result);
+    layers = std::move(layerTable);
+    report = std::move(cachedReport);
+    return true;
+}
+
+bool SceneCache::save(const std::string& dxfPath, const std::vector<std::shared_ptr<Entity>>& entities,
+    const std::map<std::string, std::shared_ptr<BlockDefinition>>& blocks, const LayerTable& layers,
+    const DxfLoadReport& report)
+{
+    CacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = VERSION;
+    if (!HashSource(dxfPath, header.sourceSize, header.sourceHash))
+        return false;
+
+    // Flatten into the on-disk sections; layer records follow the table's ids
+    LayerTable layerTable = layers;
+    std::vector<CacheLayer> layerRecords;
+    std::vector<CacheSkipped> skippedRecords;
+    std::vector<CacheBlock> blockRecords;
+    std::string strings;
+    std::vector<CacheEntity> records;
+    std::vector<CacheBulge> bulges;
+    std::vector<float> pool;
+    records.reserve(entities.size());
+
+    std::unordered_map<const BlockDefinition*, std::uint32_t> blockIndex;
+    for (const auto& [name, block] : blocks) {
+        blockIndex.emplace(block.get(), static_cast<std::uint32_t>(blockIndex.size()));
+    }
+
+    auto addRecord = [&](const Entity* entity) {
+        bool supported = false;
+        CachedType type = TypeOf(entity, supported);
+        if (!supported) return false; // a partial cache would silently drop entities
+
+        CacheEntity rec{};
+        rec.type = static_cast<std::uint32_t>(type);
+        rec.layer = layerTable.intern(entity->getLayer());
+        std::memcpy(rec.color, entity->getColor(), sizeof(rec.color));
+        rec.vertexFirst = pool.size() / 2;
+        rec.vertexCount = entity->getVertexCount();
+        pool.insert(pool.end(), entity->getVertices().begin(), entity->getVertices().end());
+
+        if (type == CachedType::Circle) {
+            const auto* circle = static_cast<const Circle*>(entity);
+            rec.params[0] = circle->getCenterX();
+            rec.params[1] = circle->getCenterY();
+            rec.params[2] = circle->getRadius();
+        }
+        else if (type == CachedType::Arc) {
+            const auto* arc = static_cast<const Arc*>(entity);
+            rec.params[0] = arc->getCenterX();
+            rec.params[1] = arc->getCenterY();
+            rec.params[2] = arc->getRadius();
+            rec.params[3] = arc->getStartAngle();
+            rec.params[4] = arc->getStartAngle() + arc->getAngleRange();
+        }
+        else if (type == CachedType::Polyline) {
+            const auto* poly = static_cast<const Polyline*>(entity);
+            rec.closed = poly->getIsClosed() ? 1 : 0;
+            rec.bulgeFirst = bulges.size();
+            rec.bulgeCount = poly->getPolyVertices().size();
+            for (const auto& v : poly->getPolyVertices()) {
+                bulges.push_back({ v.position.x, v.position.y, v.bulge });
+            }
+        }
+        else if (type == CachedType::Insert) {
+            const auto* insert = static_cast<const Insert*>(entity);
+            auto it = blockIndex.find(insert->getBlock().get());
+            if (it == blockIndex.end()) return false;
+            rec.block = it->second;
+            const glm::mat3& m = insert->getTransform();
+            rec.params[0] = m[0][0];
+            rec.params[1] = m[0][1];
+            rec.params[2] = m[1][0];
+            rec.params[3] = m[1][1];
+            rec.params[4] = m[2][0];
+            rec.params[5] = m[2][1];
+        }
+        records.push_back(rec);
+        return true;
+    };
+
+    for (const auto& entity : entities) {
+        if (!addRecord(entity.get())) return false;
+    }
+    header.modelCount = records.size();
+
+    blockRecords.reserve(blocks.size());
+    for (const auto& [name, block] : blocks) {
+        CacheBlock rec{};
+        rec.nameOffset = strings.size();
+        rec.nameLength = name.size();
+        rec.basePoint[0] = block->getBasePoint().x;
+        rec.basePoint[1] = block->getBasePoint().y;
+        rec.entityFirst = records.size();
+        for (const auto& entity : block->getEntities()) {
+            if (!addRecord(entity.get())) return false;
+        }
+        rec.entityCount = records.size() - rec.entityFirst;
+        blockRecords.push_back(rec);
+        strings += name;
+    }
+
+    layerRecords.reserve(layerTable.size());
+    for (LayerTable::LayerId id = 0; id < layerTable.size(); ++id) {
+        const LayerInfo& layer = layerTable.get(id);
+        CacheLayer rec{};
+        rec.nameOffset = strings.size();
+        rec.nameLength = layer.name.size();
+        std::memcpy(rec.color, layer.color, sizeof(rec.color));
+        rec.flags = (layer.visible ? 0u : kLayerHidden) | (layer.frozen ? kLayerFrozen : 0u);
+        layerRecords.push_back(rec);
+        strings += layer.name;
+    }
+
+    header.skippedCount = report.skippedCount;
+    skippedRecords.reserve(report.skippedByType.size());
+    for (const auto& [type, count] : report.skippedByType) {
+        skippedRecords.push_back({ strings.size(), type.size(), count });
+        strings += type;
+    }
+
+    std::uint64_t offset = Align8(sizeof(CacheHeader));
+    header.layerCount = layerRecords.size();
+    header.layerOffset = offset;
+    offset = Align8(offset + layerRecords.size() * sizeof(CacheLayer));
+    header.stringSize = strings.size();
+    header.stringOffset = offset;
+    offset = Align8(offset + strings.size());
+    header.skippedTypeCount = skippedRecords.size();
+    header.skippedTypeOffset = offset;
+    offset = Align8(offset + skippedRecords.size() * sizeof(CacheSkipped));
+    header.blockCount = blockRecords.size();
+    header.blockOffset = offset;
+    offset = Align8(offset + blockRecords.size() * sizeof(CacheBlock));
+    header.entityCount = records.size();
+    header.entityOffset = offset;
+    offset = Align8(offset + records.size() * sizeof(CacheEntity));
+    header.bulgeCount = bulges.size();
+    header.bulgeOffset = offset;
+    offset = Align8(offset + bulges.size() * sizeof(CacheBulge));
+    header.vertexCount = pool.size() / 2;
+    header.vertexOffset = offset;
+
+    // Write to a temporary file and swap it in, so a reader never maps a half-written cache
+    std::string target = cachePathFor(dxfPath);
+    std::string temp = target + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        auto writeAt = [&](std::uint64_t at, const void* data, size_t bytes) {
+            static const char zeros[8] = {};
+            std::uint64_t pos = static_cast<std::uint64_t>(out.tellp());
+            out.write(zeros, static_cast<std::streamsize>(at - pos)); // alignment padding
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeAt(header.layerOffset, layerRecords.data(), layerRecords.size() * sizeof(CacheLayer));
+        writeAt(header.stringOffset, strings.data(), strings.size());
+        writeAt(header.skippedTypeOffset, skippedRecords.data(), skippedRecords.size() * sizeof(CacheSkipped));
+        writeAt(header.blockOffset, blockRecords.data(), blockRecords.size() * sizeof(CacheBlock));
+        writeAt(header.entityOffset, records.data(), records.size() * sizeof(CacheEntity));
+        writeAt(header.bulgeOffset, bulges.data(), bulges.size() * sizeof(CacheBulge));
+        writeAt(header.vertexOffset, pool.data(), pool.size() * sizeof(float));
+        if (!out) {
+            out.close();
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+
+    std::remove(target.c_str()); // rename does not replace on Windows
+    if (std::rename(temp.c_str(), target.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,558 @@
+#include "SceneStore.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/ext/scalar_constants.hpp>
+#include "Entities/Line.h"
+#include "Entities/Circle.h"
+#include "Entities/Arc.h"
+#include "Entities/Polyline.h"
+#include "Entities/Insert.h"
+#include "AutoDxfHelper.h"
+
+namespace {
+
+// Dirty ids this close to a run join it, as one upload of the gap costs less
+// than another call; past kMaxDirtyRuns runs they fold into one span
+constexpr size_t kDirtyRunGap = 8;
+constexpr size_t kMaxDirtyRuns = 32;
+
+// Adds id to the sorted, disjoint runs, joining the runs around it when close
+void MarkRun(std::vector<std::pair<size_t, size_t>>& runs, size_t id)
+{
+    auto next = std::upper_bound(runs.begin(), runs.end(), id,
+        [](size_t value, const std::pair<size_t, size_t>& run) { return value < run.first; });
+    if (next != runs.begin()) {
+        auto prev = next - 1;
+        if (id < prev->second) return;
+        if (id <= prev->second + kDirtyRunGap) {
+            prev->second = id + 1;
+            if (next != runs.end() && next->first <= prev->second + kDirtyRunGap) {
+                prev->second = next->second;
+                runs.erase(next);
+            }
+            return;
+        }
+    }
+    if (next != runs.end() && next->first <= id + 1 + kDirtyRunGap) {
+        next->first = id;
+        return;
+    }
+    runs.insert(next, { id, id + 1 });
+    if (runs.size() > kMaxDirtyRuns)
+        runs = { { runs.front().first, runs.back().second } };
+}
+
+SceneStore::Kind KindOf(const Entity& entity)
+{
+    if (dynamic_cast<const Insert*>(&entity)) return SceneStore::Kind::Insert;
+    if (dynamic_cast<const Polyline*>(&entity)) return SceneStore::Kind::Polyline;
+    if (dynamic_cast<const Arc*>(&entity)) return SceneStore::Kind::Arc;
+    if (dynamic_cast<const Circle*>(&entity)) return SceneStore::Kind::Circle;
+    if (dynamic_cast<const Line*>(&entity)) return SceneStore::Kind::Line;
+    return SceneStore::Kind::Other;
+}
+
+float SegmentDistanceSq(float px, float py, float x1, float y1, float x2, float y2)
+{
+    float dx = x2 - x1, dy = y2 - y1;
+    float lenSq = dx * dx + dy * dy;
+    float t = (lenSq > 0) ? std::clamp(((px - x1) * dx + (py - y1) * dy) / lenSq, 0.f, 1.f) : 0.f;
+    float ex = x1 + t * dx - px, ey = y1 + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+// Liang-Barsky clip: true if any part of the segment lies in the rectangle
+bool SegmentInRect(float x1, float y1, float x2, float y2, const float* rect)
+{
+    float t0 = 0.0f, t1 = 1.0f;
+    const float dx = x2 - x1, dy = y2 - y1;
+    const float p[4] = { -dx, dx, -dy, dy };
+    const float q[4] = { x1 - rect[0], rect[2] - x1, y1 - rect[1], rect[3] - y1 };
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) return false;
+            continue;
+        }
+        float t = q[i] / p[i];
+        if (p[i] < 0.0f) t0 = std::max(t0, t);
+        else t1 = std::min(t1, t);
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+// Walks the segments of a vertex range the way OpenGL connects them;
+// fn returns true to stop
+template <typename Fn>
+void ForEachSegment(const float* v, std::uint32_t count, Entity::DrawMode mode, Fn&& fn)
+{
+    std::uint32_t step = mode == Entity::DrawMode::Lines ? 2 : 1;
+    for (std::uint32_t i = 0; i + 1 < count; i += step) {
+        if (fn(v + i * 2, v + i * 2 + 2)) return;
+    }
+    if (mode == Entity::DrawMode::LineLoop && count > 2)
+        fn(v + (count - 1) * 2, v);
+}
+
+bool AngleInSweep(float angle, float start, float sweep)
+{
+    const float twoPi = 2.0f * glm::pi<float>();
+    if (sweep >= twoPi) return true;
+    float offset = std::fmod(angle - start, twoPi);
+    if (offset < 0.0f) offset += twoPi;
+    return offset <= sweep;
+}
+
+bool ArcInRect(const SceneStore::CurveInstance& c, const float* rect)
+{
+    auto inside = [&](float x, float y) { return x >= rect[0] && x <= rect[2] && y >= rect[1] && y <= rect[3]; };
+    if (inside(c.cx + c.radius * std::cos(c.startAngle), c.cy + c.radius * std::sin(c.startAngle)))
+        return true;
+
+    // Otherwise the curve has to cross an edge of the rectangle
+    const float corners[4][2] = { { rect[0], rect[1] }, { rect[2], rect[1] }, { rect[2], rect[3] }, { rect[0], rect[3] } };
+    for (int e = 0; e < 4; ++e) {
+        const float* a = corners[e];
+        const float* b = corners[(e + 1) % 4];
+        float dx = b[0] - a[0], dy = b[1] - a[1];
+        float fx = a[0] - c.cx, fy = a[1] - c.cy;
+        float qa = dx * dx + dy * dy;
+        float qb = 2.0f * (fx * dx + fy * dy);
+        float qc = fx * fx + fy * fy - c.radius * c.radius;
+        float disc = qb * qb - 4.0f * qa * qc;
+        if (qa == 0.0f || disc < 0.0f) continue;
+        float root = std::sqrt(disc);
+        for (float t : { (-qb - root) / (2.0f * qa), (-qb + root) / (2.0f * qa) }) {
+            if (t < 0.0f || t > 1.0f) continue;
+            float angle = std::atan2(fy + t * dy, fx + t * dx);
+            if (AngleInSweep(angle, c.startAngle, c.sweep)) return true;
+        }
+    }
+    return false;
+}
+
+}
+
+SceneStore::EntityId SceneStore::add(const Entity& entity)
+{
+    EntityId id = static_cast<EntityId>(_kinds.size());
+
+    _kinds.push_back(KindOf(entity));
+    _modes.push_back(entity.getDrawMode());
+    const float* color = entity.getColor();
+    _colors.insert(_colors.end(), color, color + 3);
+    _alphas.push_back(entity.getAlpha());
+    _states.push_back(0);
+    markStateDirty(id);
+
+    LayerTable::LayerId layer = _layers.intern(entity.getLayer());
+    if (layer >= _layerEntities.size()) _layerEntities.resize(layer + 1);
+    _layerEntities[layer].push_back(id);
+    _layerIds.push_back(layer);
+
+    float bounds[4];
+    if (!entity.getBounds(bounds)) {
+        // Empty box that no point falls into
+        bounds[0] = bounds[1] = 1.0f;
+        bounds[2] = bounds[3] = -1.0f;
+    }
+    _bounds.insert(_bounds.end(), bounds, bounds + 4);
+
+    CurveInstance curve{};
+    if (entity.getCircularArc(curve.cx, curve.cy, curve.radius, curve.startAngle, curve.sweep)) {
+        curve.id = id;
+        _curveOf.push_back(static_cast<std::uint32_t>(_curves.size()));
+        _curves.push_back(curve);
+        // No pool range: the renderer draws the curve from its parameters
+        _vertexFirst.push_back(static_cast<std::uint32_t>(_vertexPool.size() / 2));
+        _vertexCount.push_back(0);
+        _vertexCapacity.push_back(0);
+        _lodFirst.push_back(0);
+        _lodCount.push_back(0);
+        markStyleDirty(id);
+        ++_geometryVersion;
+        return id;
+    }
+    _curveOf.push_back(INVALID_ID);
+
+    // Empty range at the end of the pool that writeVertices grows
+    _vertexFirst.push_back(static_cast<std::uint32_t>(_vertexPool.size() / 2));
+    _vertexCount.push_back(0);
+    _vertexCapacity.push_back(0);
+    _lodFirst.push_back(static_cast<std::uint32_t>(_lods.size()));
+    _lodCount.push_back(0);
+    writeVertices(id, entity);
+    markStyleDirty(id);
+    ++_geometryVersion;
+
+    if (!_drawListsDirty)
+        appendToDrawList(id);
+    return id;
+}
+
+void SceneStore::appendToDrawList(EntityId id)
+{
+    DrawRange range = getDrawRange(id);
+    if (range.count == 0) return;
+    size_t index = static_cast<size_t>(_layerIds[id]) * kDrawListCount + range.list;
+    if (index >= _drawLists.size())
+        _drawLists.resize((static_cast<size_t>(_layerIds[id]) + 1) * kDrawListCount);
+    _drawLists[index].first.push_back(range.first);
+    _drawLists[index].count.push_back(range.count);
+}
+
+SceneStore::DrawRange SceneStore::getDrawRange(EntityId id) const
+{
+    DrawRange range{ static_cast<std::int32_t>(_vertexFirst[id]), static_cast<std::int32_t>(_vertexCount[id]),
+        static_cast<size_t>(_modes[id]) };
+    if (range.count == 0 || _lodPixelSize <= 0.0f) return range;
+
+    const float* b = &_bounds[id * 4];
+    if (std::max(b[2] - b[0], b[3] - b[1]) < _lodPixelSize) {
+        range.count = 1;
+        range.list = POINT_LIST;
+        return range;
+    }
+    for (std::uint32_t i = _lodFirst[id]; i < _lodFirst[id] + _lodCount[id]; ++i) {
+        if (_lods[i].tolerance < _lodPixelSize) {
+            range.first += static_cast<std::int32_t>(_lods[i].offset);
+            range.count = static_cast<std::int32_t>(_lods[i].count);
+            break;
+        }
+    }
+    return range;
+}
+
+void SceneStore::setLodPixelSize(float worldPerPixel)
+{
+    if (worldPerPixel == _lodPixelSize) return;
+    _lodPixelSize = worldPerPixel;
+    _drawListsDirty = true;
+}
+
+void SceneStore::updateDrawLists()
+{
+    if (!_drawListsDirty) return;
+    for (auto& list : _drawLists) {
+        list.first.clear();
+        list.count.clear();
+    }
+    // Layer lists keep insertion order within each layer
+    for (const auto& ids : _layerEntities) {
+        for (EntityId id : ids)
+            appendToDrawList(id);
+    }
+    _drawListsDirty = false;
+}
+
+const SceneStore::DrawList& SceneStore::getDrawList(std::uint32_t layerId, Entity::DrawMode mode) const
+{
+    static const DrawList empty;
+    size_t index = static_cast<size_t>(layerId) * kDrawListCount + static_cast<size_t>(mode);
+    return index < _drawLists.size() ? _drawLists[index] : empty;
+}
+
+const SceneStore::DrawList& SceneStore::getPointList(std::uint32_t layerId) const
+{
+    static const DrawList empty;
+    size_t index = static_cast<size_t>(layerId) * kDrawListCount + POINT_LIST;
+    return index < _drawLists.size() ? _drawLists[index] : empty;
+}
+
+void SceneStore::packStyles(std::vector<std::uint32_t>& rgba) const
+{
+    auto toByte = [](float v) { return static_cast<std::uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    rgba.resize(_kinds.size());
+    for (auto [begin, end] : _styleDirtyRuns) {
+        for (size_t id = begin; id < end; ++id) {
+            const float* c = &_colors[id * 3];
+            // Byte order R, G, B, A in memory on little-endian machines
+            rgba[id] = toByte(c[0]) | (toByte(c[1]) << 8) | (toByte(c[2]) << 16) | (toByte(_alphas[id]) << 24);
+        }
+    }
+}
+
+void SceneStore::writeVertices(EntityId id, const Entity& entity)
+{
+    const auto& vertices = entity.getVertices();
+    const auto& levels = entity.getLodLevels();
+    size_t span = vertices.size();
+    for (const auto& level : levels)
+        span += level.vertices.size();
+
+    if (span / 2 > _vertexCapacity[id]) {
+        // Grown: free the old range and move to one that fits
+        if (_vertexCapacity[id] > 0) {
+            _freeRanges.emplace(_vertexCapacity[id], _vertexFirst[id]);
+            _garbage += static_cast<size_t>(_vertexCapacity[id]) * 2;
+        }
+        _vertexFirst[id] = allocateRange(id, static_cast<std::uint32_t>(span / 2));
+        _vertexCapacity[id] = static_cast<std::uint32_t>(span / 2);
+    }
+
+    size_t begin = static_cast<size_t>(_vertexFirst[id]) * 2;
+    auto out = std::copy(vertices.begin(), vertices.end(), _vertexPool.begin() + begin);
+    _vertexCount[id] = static_cast<std::uint32_t>(vertices.size() / 2);
+
+    // Same number of levels reuses the entity's entries, else they move to the end
+    if (levels.size() != _lodCount[id]) {
+        _lodFirst[id] = static_cast<std::uint32_t>(_lods.size());
+        _lodCount[id] = static_cast<std::uint32_t>(levels.size());
+        _lods.resize(_lods.size() + levels.size());
+    }
+    std::uint32_t offset = _vertexCount[id];
+    for (size_t i = 0; i < levels.size(); ++i) {
+        std::uint32_t count = static_cast<std::uint32_t>(levels[i].vertices.size() / 2);
+        out = std::copy(levels[i].vertices.begin(), levels[i].vertices.end(), out);
+        _lods[_lodFirst[id] + i] = { levels[i].tolerance, offset, count };
+        offset += count;
+    }
+    markDirty(begin, begin + span);
+}
+
+std::uint32_t SceneStore::allocateRange(EntityId id, std::uint32_t count)
+{
+    std::uint32_t first;
+    auto it = _freeRanges.lower_bound(count);
+    if (it != _freeRanges.end()) {
+        // Smallest freed range that fits; the rest stays free
+        auto [size, start] = *it;
+        _freeRanges.erase(it);
+        if (size > count)
+            _freeRanges.emplace(size - count, start + count);
+        _garbage -= static_cast<size_t>(count) * 2;
+        first = start;
+    }
+    else {
+        first = static_cast<std::uint32_t>(_vertexPool.size() / 2);
+        _vertexPool.resize(_vertexPool.size() + static_cast<size_t>(count) * 2);
+        _vertexOwners.resize(_vertexPool.size() / 2);
+    }
+    std::fill(_vertexOwners.begin() + first, _vertexOwners.begin() + first + count, id);
+    return first;
+}
+
+void SceneStore::updateGeometry(EntityId id, const Entity& entity)
+{
+    if (isCurve(id)) return;
+
+    DrawRange before = getDrawRange(id);
+    writeVertices(id, entity);
+    ++_geometryVersion;
+
+    const auto& vertices = entity.getVertices();
+    std::uint32_t count = _vertexCount[id];
+    float* bounds = &_bounds[id * 4];
+    if (count > 0) {
+        bounds[0] = bounds[2] = vertices[0];
+        bounds[1] = bounds[3] = vertices[1];
+        for (size_t i = 2; i + 1 < vertices.size(); i += 2) {
+            bounds[0] = std::min(bounds[0], vertices[i]);
+            bounds[1] = std::min(bounds[1], vertices[i + 1]);
+            bounds[2] = std::max(bounds[2], vertices[i]);
+            bounds[3] = std::max(bounds[3], vertices[i + 1]);
+        }
+    }
+
+    DrawRange after = getDrawRange(id);
+    if (after.first != before.first || after.count != before.count || after.list != before.list)
+        _drawListsDirty = true; // the entity's range changes
+
+    // Zooming back and forth would otherwise keep growing the pool
+    if (_garbage > _vertexPool.size() / 2)
+        compact();
+}
+
+void SceneStore::updateBounds(EntityId id, const Entity& entity)
+{
+    float* bounds = &_bounds[id * 4];
+    if (!entity.getBounds(bounds)) {
+        bounds[0] = bounds[1] = 1.0f;
+        bounds[2] = bounds[3] = -1.0f;
+    }
+    ++_geometryVersion;
+}
+
+void SceneStore::compact()
+{
+    std::vector<float> pool;
+    std::vector<EntityId> owners;
+    std::vector<LodRange> lods;
+    pool.reserve(_vertexPool.size() - _garbage);
+    owners.reserve(pool.capacity() / 2);
+    for (size_t id = 0; id < _kinds.size(); ++id) {
+        // The full vertices and every level after them
+        std::uint32_t span = _vertexCount[id];
+        for (std::uint32_t i = _lodFirst[id]; i < _lodFirst[id] + _lodCount[id]; ++i)
+            span = std::max(span, _lods[i].offset + _lods[i].count);
+        lods.insert(lods.end(), _lods.begin() + _lodFirst[id], _lods.begin() + _lodFirst[id] + _lodCount[id]);
+        _lodFirst[id] = static_cast<std::uint32_t>(lods.size() - _lodCount[id]);
+
+        size_t begin = static_cast<size_t>(_vertexFirst[id]) * 2;
+        _vertexFirst[id] = static_cast<std::uint32_t>(pool.size() / 2);
+        _vertexCapacity[id] = span;
+        pool.insert(pool.end(), _vertexPool.begin() + begin, _vertexPool.begin() + begin + span * 2);
+        owners.resize(pool.size() / 2, static_cast<EntityId>(id));
+    }
+    _vertexPool.swap(pool);
+    _vertexOwners.swap(owners);
+    _lods.swap(lods);
+    _freeRanges.clear();
+    _drawListsDirty = true;
+    _garbage = 0;
+    _rebuilt = true;
+}
+
+void SceneStore::clear()
+{
+    _kinds.clear();
+    _modes.clear();
+    _colors.clear();
+    _alphas.clear();
+    _states.clear();
+    _selection.clear();
+    _hovered = INVALID_ID;
+    _stateDirtyRuns.clear();
+    _layerIds.clear();
+    _bounds.clear();
+    _vertexFirst.clear();
+    _vertexCount.clear();
+    _vertexCapacity.clear();
+    _lods.clear();
+    _lodFirst.clear();
+    _lodCount.clear();
+    _layers.clear();
+    _layerEntities.clear();
+    _vertexPool.clear();
+    _vertexOwners.clear();
+    _curves.clear();
+    _curveOf.clear();
+    _drawLists.clear();
+    _drawListsDirty = false;
+    _garbage = 0;
+    _freeRanges.clear();
+    _dirtyRanges.clear();
+    _styleDirtyRuns.clear();
+    _rebuilt = true;
+    ++_geometryVersion;
+}
+
+const std::vector<SceneStore::EntityId>& SceneStore::getLayerEntities(std::uint32_t layerId) const
+{
+    // Layers known from the LAYER table may have no entities yet
+    static const std::vector<EntityId> empty;
+    return layerId < _layerEntities.size() ? _layerEntities[layerId] : empty;
+}
+
+void SceneStore::setStateFlag(EntityId id, std::uint8_t flag, bool on)
+{
+    std::uint8_t state = on ? (_states[id] | flag) : (_states[id] & ~flag);
+    if (state == _states[id]) return;
+    _states[id] = state;
+    markStateDirty(id);
+}
+
+void SceneStore::markStateDirty(EntityId id)
+{
+    MarkRun(_stateDirtyRuns, id);
+}
+
+void SceneStore::setSelected(EntityId id, bool selected)
+{
+    if (((_states[id] & Selected) != 0) == selected) return;
+    setStateFlag(id, Selected, selected);
+    if (selected) {
+        _selection.push_back(id);
+    }
+    else {
+        auto it = std::find(_selection.begin(), _selection.end(), id);
+        *it = _selection.back();
+        _selection.pop_back();
+    }
+}
+
+void SceneStore::clearSelection()
+{
+    for (EntityId id : _selection)
+        setStateFlag(id, Selected, false);
+    _selection.clear();
+}
+
+void SceneStore::setHovered(EntityId id)
+{
+    if (id == _hovered) return;
+    if (_hovered != INVALID_ID) setStateFlag(_hovered, Hovered, false);
+    _hovered = id;
+    if (_hovered != INVALID_ID) setStateFlag(_hovered, Hovered, true);
+}
+
+float SceneStore::distanceTo(EntityId id, float x, float y) const
+{
+    if (_kinds[id] == Kind::Insert) return -1.0f;
+    if (_curveOf[id] != INVALID_ID) {
+        const CurveInstance& c = _curves[_curveOf[id]];
+        return AutoDxfHelper::DistanceToArc({ x, y }, { c.cx, c.cy }, c.radius, c.startAngle, c.sweep);
+    }
+
+    float best = INFINITY;
+    const float* v = _vertexPool.data() + static_cast<size_t>(_vertexFirst[id]) * 2;
+    ForEachSegment(v, _vertexCount[id], _modes[id], [&](const float* a, const float* b) {
+        best = std::min(best, SegmentDistanceSq(x, y, a[0], a[1], b[0], b[1]));
+        return false;
+    });
+    return std::sqrt(best);
+}
+
+int SceneStore::touchesRect(EntityId id, const float rect[4]) const
+{
+    if (_kinds[id] == Kind::Insert) return -1;
+    if (_curveOf[id] != INVALID_ID)
+        return ArcInRect(_curves[_curveOf[id]], rect) ? 1 : 0;
+
+    bool hit = false;
+    const float* v = _vertexPool.data() + static_cast<size_t>(_vertexFirst[id]) * 2;
+    ForEachSegment(v, _vertexCount[id], _modes[id], [&](const float* a, const float* b) {
+        return hit = SegmentInRect(a[0], a[1], b[0], b[1], rect);
+    });
+    return hit ? 1 : 0;
+}
+
+void SceneStore::markDirty(size_t begin, size_t end)
+{
+    if (begin >= end) return;
+    // Appending entities writes back to back, which stays one range
+    if (!_dirtyRanges.empty() && begin <= _dirtyRanges.back().second && end >= _dirtyRanges.back().first) {
+        auto& last = _dirtyRanges.back();
+        last.first = std::min(last.first, begin);
+        last.second = std::max(last.second, end);
+        return;
+    }
+    _dirtyRanges.emplace_back(begin, end);
+}
+
+void SceneStore::getDirtyRanges(size_t mergeGap, std::vector<std::pair<size_t, size_t>>& out) const
+{
+    out = _dirtyRanges;
+    std::sort(out.begin(), out.end());
+    size_t merged = 0;
+    for (size_t i = 1; i < out.size(); ++i) {
+        if (out[i].first <= out[merged].second + mergeGap)
+            out[merged].second = std::max(out[merged].second, out[i].second);
+        else
+            out[++merged] = out[i];
+    }
+    if (!out.empty()) out.resize(merged + 1);
+}
+
+void SceneStore::markStyleDirty(EntityId id)
+{
+    MarkRun(_styleDirtyRuns, id);
+}
+
+void SceneStore::markUploaded()
+{
+    _dirtyRanges.clear();
+    _rebuilt = false;
+    _styleDirtyRuns.clear();
+    _stateDirtyRuns.clear();
+}
@@ -0,0 +1,182 @@
+#include "SegmentSweep.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace {
+
+// Centered interval tree over the y intervals of one set. The shape is fixed
+// up front from all intervals; pieces are switched on and off as the sweep
+// passes them, and subtrees without active pieces are skipped by queries.
+class IntervalTree
+{
+public:
+    IntervalTree(const std::vector<float>& minY, const std::vector<float>& maxY, std::vector<std::uint32_t> ids)
+        : _minY(minY), _maxY(maxY), _nodeOf(minY.size(), -1)
+    {
+        build(ids, -1);
+    }
+
+    void insert(std::uint32_t id) { update(id, true); }
+    void erase(std::uint32_t id) { update(id, false); }
+
+    // fn(id) for every active interval overlapping [lo, hi]
+    template <typename Fn>
+    void query(float lo, float hi, Fn&& fn) const
+    {
+        if (!_nodes.empty()) query(0, lo, hi, fn);
+    }
+
+private:
+    struct Node {
+        Node(float nodeCenter, std::int32_t nodeParent) : center(nodeCenter), parent(nodeParent) {}
+
+        float center;
+        std::int32_t parent;
+        std::int32_t left = -1;
+        std::int32_t right = -1;
+        size_t active = 0;                  // in this node and below
+        std::set<std::pair<float, std::uint32_t>> byMin, byMax;
+    };
+
+    std::int32_t build(std::vector<std::uint32_t>& items, std::int32_t parent)
+    {
+        if (items.empty()) return -1;
+
+        // Median endpoint as center, so each side gets at most half the intervals
+        std::vector<float> ends;
+        ends.reserve(items.size() * 2);
+        for (std::uint32_t id : items) {
+            ends.push_back(_minY[id]);
+            ends.push_back(_maxY[id]);
+        }
+        std::nth_element(ends.begin(), ends.begin() + ends.size() / 2, ends.end());
+        const float center = ends[ends.size() / 2];
+
+        const std::int32_t index = static_cast<std::int32_t>(_nodes.size());
+        _nodes.emplace_back(center, parent);
+        std::vector<std::uint32_t> left, right;
+        for (std::uint32_t id : items) {
+            if (_maxY[id] < center) left.push_back(id);
+            else if (_minY[id] > center) right.push_back(id);
+            else _nodeOf[id] = index;
+        }
+        items = std::vector<std::uint32_t>();
+        const std::int32_t l = build(left, index);
+        const std::int32_t r = build(right, index);
+        _nodes[index].left = l;
+        _nodes[index].right = r;
+        return index;
+    }
+
+    void update(std::uint32_t id, bool on)
+    {
+        std::int32_t index = _nodeOf[id];
+        Node& node = _nodes[index];
+        if (on) {
+            node.byMin.emplace(_minY[id], id);
+            node.byMax.emplace(_maxY[id], id);
+        }
+        else {
+            node.byMin.erase({ _minY[id], id });
+            node.byMax.erase({ _maxY[id], id });
+        }
+        for (; index >= 0; index = _nodes[index].parent) {
+            if (on) ++_nodes[index].active;
+            else --_nodes[index].active;
+        }
+    }
+
+    template <typename Fn>
+    void query(std::int32_t index, float lo, float hi, Fn& fn) const
+    {
+        const Node& node = _nodes[index];
+        if (node.active == 0) return;
+
+        // Every interval of a node contains its center, so only one end needs checking
+        if (node.center < lo) {
+            for (auto it = node.byMax.lower_bound({ lo, 0 }); it != node.byMax.end(); ++it)
+                fn(it->second);
+            if (node.right >= 0) query(node.right, lo, hi, fn);
+        }
+        else if (node.center > hi) {
+            for (auto it = node.byMin.begin(); it != node.byMin.end() && it->first <= hi; ++it)
+                fn(it->second);
+            if (node.left >= 0) query(node.left, lo, hi, fn);
+        }
+        else {
+            for (const auto& entry : node.byMin)
+                fn(entry.second);
+            if (node.left >= 0) query(node.left, lo, hi, fn);
+            if (node.right >= 0) query(node.right, lo, hi, fn);
+        }
+    }
+
+    const std::vector<float>& _minY;
+    const std::vector<float>& _maxY;
+    std::vector<std::int32_t> _nodeOf;
+    std::vector<Node> _nodes;
+};
+
+struct Event {
+    float x;
+    bool leave;
+    std::uint32_t piece;
+};
+
+}
+
+void SegmentSweep::add(int set, const float box[4], std::uint32_t owner)
+{
+    for (int i = 0; i < 4; ++i)
+        if (!std::isfinite(box[i])) return;
+    _pieces.push_back(Piece{ { box[0], box[1], box[2], box[3] }, owner, static_cast<std::uint8_t>(set != 0) });
+}
+
+void SegmentSweep::clear()
+{
+    _pieces.clear();
+}
+
+void SegmentSweep::run(std::vector<std::pair<std::uint32_t, std::uint32_t>>& pairs) const
+{
+    pairs.clear();
+    const std::uint32_t count = static_cast<std::uint32_t>(_pieces.size());
+
+    std::vector<float> minY(count), maxY(count);
+    std::vector<std::uint32_t> ids[2];
+    std::vector<Event> events;
+    events.reserve(static_cast<size_t>(count) * 2);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const Piece& piece = _pieces[i];
+        minY[i] = piece.box[1];
+        maxY[i] = piece.box[3];
+        ids[piece.set].push_back(i);
+        events.push_back({ piece.box[0], false, i });
+        events.push_back({ piece.box[2], true, i });
+    }
+    if (ids[0].empty() || ids[1].empty()) return;
+
+    // Entering before leaving at the same x, so boxes that only touch still meet
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        if (a.x != b.x) return a.x < b.x;
+        return a.leave < b.leave;
+    });
+
+    IntervalTree trees[2] = { IntervalTree(minY, maxY, std::move(ids[0])), IntervalTree(minY, maxY, std::move(ids[1])) };
+    for (const Event& event : events) {
+        const Piece& piece = _pieces[event.piece];
+        if (event.leave) {
+            trees[piece.set].erase(event.piece);
+            continue;
+        }
+        trees[piece.set ^ 1].query(piece.box[1], piece.box[3], [&](std::uint32_t other) {
+            if (piece.set == 0) pairs.emplace_back(piece.owner, _pieces[other].owner);
+            else pairs.emplace_back(_pieces[other].owner, piece.owner);
+        });
+        trees[piece.set].insert(event.piece);
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
@@ -0,0 +1,178 @@
+#include "Tessellator.h"
+#include <algorithm>
+#include "Entities/Polyline.h"
+#include "MemoryStats.h"
+
+namespace {
+
+// Rough cost of an entity that is not a polyline, in source vertices
+constexpr size_t kCurveCost = 64;
+constexpr size_t kNoSplit = static_cast<size_t>(-1);
+
+// A polyline too long for one unit of work, tessellated in pieces
+struct SplitPolyline {
+    Polyline* polyline;
+    std::vector<std::uint32_t> offsets;     // first output vertex per source vertex, then the total
+    std::vector<float> vertices;
+};
+
+// Entities [first, last) tessellated whole, or source vertices [first, last)
+// of splits[split]
+struct WorkItem {
+    size_t first;
+    size_t last;
+    size_t split;
+};
+
+void TessellateWhole(Entity& entity, float chordTolerance)
+{
+    if (auto* polyline = dynamic_cast<Polyline*>(&entity)) {
+        polyline->setVertices(Polyline::Tessellate(polyline->getPolyVertices(), polyline->getIsClosed(), chordTolerance));
+        return;
+    }
+    std::vector<float> vertices;
+    if (entity.tessellate(chordTolerance, vertices))
+        entity.setVertices(std::move(vertices));
+}
+
+}
+
+Tessellator::Tessellator(unsigned threads)
+    : _threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+Tessellator::~Tessellator()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+void Tessellator::workerLoop()
+{
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _wake.wait(lock, [&] { return _stop || _jobGeneration != seen; });
+        if (_stop) return;
+        seen = _jobGeneration;
+        const std::function<void(size_t)>& fn = *_job;
+        const size_t count = _jobCount;
+        lock.unlock();
+
+        const std::uint64_t allocationsBefore = MemoryStats::threadAllocationCount();
+        for (size_t i = _next++; i < count; i = _next++) fn(i);
+        const std::uint64_t allocations = MemoryStats::threadAllocationCount() - allocationsBefore;
+
+        lock.lock();
+        _workerAllocations += allocations;
+        if (--_busy == 0) _done.notify_one();
+    }
+}
+
+void Tessellator::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (_threads <= 1 || count <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    if (_workers.empty()) {
+        _workers.reserve(_threads - 1);
+        for (unsigned t = 1; t < _threads; ++t)
+            _workers.emplace_back(&Tessellator::workerLoop, this);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = &fn;
+        _jobCount = count;
+        _next = 0;
+        _busy = static_cast<unsigned>(_workers.size());
+        ++_jobGeneration;
+    }
+    _wake.notify_all();
+
+    for (size_t i = _next++; i < count; i = _next++) fn(i); // the calling thread takes a share
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [&] { return _busy == 0; });
+    _job = nullptr;
+}
+
+size_t Tessellator::run(const std::vector<std::shared_ptr<Entity>>& entities, float chordTolerance)
+{
+    // Cut the batch into units of about kGrainVertices source vertices
+    std::vector<SplitPolyline> splits;
+    std::vector<WorkItem> items;
+    size_t batchFirst = 0, batchCost = 0;
+    for (size_t i = 0; i < entities.size(); ++i) {
+        auto* polyline = dynamic_cast<Polyline*>(entities[i].get());
+        size_t cost = polyline ? polyline->getPolyVertices().size() : kCurveCost;
+        if (polyline && cost > kGrainVertices) {
+            if (batchFirst < i) items.push_back({ batchFirst, i, kNoSplit });
+            batchFirst = i + 1;
+            batchCost = 0;
+
+            SplitPolyline split{ polyline, std::vector<std::uint32_t>(cost + 1), {} };
+            for (size_t first = 0; first < cost; first += kGrainVertices)
+                items.push_back({ first, std::min(cost, first + kGrainVertices), splits.size() });
+            splits.push_back(std::move(split));
+            continue;
+        }
+        batchCost += cost;
+        if (batchCost >= kGrainVertices) {
+            items.push_back({ batchFirst, i + 1, kNoSplit });
+            batchFirst = i + 1;
+            batchCost = 0;
+        }
+    }
+    if (batchFirst < entities.size())
+        items.push_back({ batchFirst, entities.size(), kNoSplit });
+
+    // Whole entities are done in one pass; split polylines count their output first
+    parallelFor(items.size(), [&](size_t index) {
+        const WorkItem& item = items[index];
+        if (item.split == kNoSplit) {
+            for (size_t i = item.first; i < item.last; ++i)
+                TessellateWhole(*entities[i], chordTolerance);
+            return;
+        }
+        SplitPolyline& split = splits[item.split];
+        Polyline::CountTessellated(split.polyline->getPolyVertices(), split.polyline->getIsClosed(), chordTolerance,
+            item.first, item.last, &split.offsets[item.first]);
+    });
+
+    if (!splits.empty()) {
+        // Counts become offsets, and each piece writes its own slice of the output
+        for (SplitPolyline& split : splits) {
+            std::uint32_t total = 0;
+            for (std::uint32_t& offset : split.offsets) {
+                std::uint32_t count = offset;
+                offset = total;
+                total += count;
+            }
+            split.vertices.resize(static_cast<size_t>(total) * 2);
+        }
+        parallelFor(items.size(), [&](size_t index) {
+            const WorkItem& item = items[index];
+            if (item.split == kNoSplit) return;
+            SplitPolyline& split = splits[item.split];
+            Polyline::TessellateRange(split.polyline->getPolyVertices(), split.polyline->getIsClosed(), chordTolerance,
+                item.first, item.last, &split.vertices[static_cast<size_t>(split.offsets[item.first]) * 2]);
+        });
+        // Adopting the vertices builds the LOD levels, one polyline per thread
+        parallelFor(splits.size(), [&](size_t index) {
+            splits[index].polyline->setVertices(std::move(splits[index].vertices));
+        });
+    }
+
+    size_t vertexCount = 0;
+    for (const auto& entity : entities)
+        vertexCount += entity->getVertexCount();
+    return vertexCount;
+}
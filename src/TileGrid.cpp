@@ -0,0 +1,221 @@
+#include "TileGrid.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Aim for a few entities per cell, but keep the grid itself small
+constexpr float kEntitiesPerCell = 8.0f;
+constexpr int kMaxCellsPerSide = 512;
+// An entity touching more cells than this goes to the large list
+constexpr int kMaxCellsPerEntity = 64;
+// Rebuild when the tail holds more than this many boxes
+// and more than 1/kTailFraction of the filed ones
+constexpr size_t kMinTail = 256;
+constexpr size_t kTailFraction = 8;
+
+bool HasBox(const float* b) { return b[0] <= b[2] && b[1] <= b[3]; }
+
+void Grow(float* extent, const float* b)
+{
+    extent[0] = std::min(extent[0], b[0]);
+    extent[1] = std::min(extent[1], b[1]);
+    extent[2] = std::max(extent[2], b[2]);
+    extent[3] = std::max(extent[3], b[3]);
+}
+
+}
+
+void TileGrid::clear()
+{
+    _bounds = nullptr;
+    _count = 0;
+    _built = 0;
+    _reach[0] = _reach[1] = INFINITY;
+    _reach[2] = _reach[3] = -INFINITY;
+    _columns = _rows = 0;
+    _cellStart.clear();
+    _cellItems.clear();
+    _large.clear();
+    _tail.clear();
+    _filed.clear();
+    _cellRect.clear();
+}
+
+int TileGrid::cellX(float x) const
+{
+    return std::clamp(static_cast<int>((x - _extent[0]) / _cellWidth), 0, _columns - 1);
+}
+
+int TileGrid::cellY(float y) const
+{
+    return std::clamp(static_cast<int>((y - _extent[1]) / _cellHeight), 0, _rows - 1);
+}
+
+bool TileGrid::isLarge(const float* b) const
+{
+    return (cellX(b[2]) - cellX(b[0]) + 1) * (cellY(b[3]) - cellY(b[1]) + 1) > kMaxCellsPerEntity;
+}
+
+void TileGrid::addToTail(std::uint32_t id)
+{
+    _filed[id] = Filed::Tail;
+    _tail.push_back(id);
+    Grow(_reach, &(*_bounds)[id * 4]);
+}
+
+void TileGrid::build(const std::vector<float>& bounds)
+{
+    clear();
+    _bounds = &bounds;
+    const size_t count = bounds.size() / 4;
+    _count = count;
+    _filed.assign(count, Filed::None);
+    _cellRect.assign(count * 4, 0);
+
+    size_t boxed = 0;
+    _extent[0] = _extent[1] = INFINITY;
+    _extent[2] = _extent[3] = -INFINITY;
+    for (size_t i = 0; i < count; ++i) {
+        const float* b = &bounds[i * 4];
+        if (!HasBox(b)) continue;
+        Grow(_extent, b);
+        ++boxed;
+    }
+    std::copy(_extent, _extent + 4, _reach);
+    _built = boxed;
+    if (boxed == 0) return;
+
+    // Square-ish cells over the extent
+    float width = std::max(_extent[2] - _extent[0], 1e-6f);
+    float height = std::max(_extent[3] - _extent[1], 1e-6f);
+    float cells = std::max(1.0f, boxed / kEntitiesPerCell);
+    float side = std::sqrt(width * height / cells);
+    _columns = std::clamp(static_cast<int>(std::ceil(width / side)), 1, kMaxCellsPerSide);
+    _rows = std::clamp(static_cast<int>(std::ceil(height / side)), 1, kMaxCellsPerSide);
+    _cellWidth = width / _columns;
+    _cellHeight = height / _rows;
+
+    // Counting pass, then fill, so the cells share one flat array
+    const size_t cellCount = static_cast<size_t>(_columns) * _rows;
+    _cellStart.assign(cellCount + 1, 0);
+    auto forEachCell = [&](const float* b, auto&& fn) {
+        int x0 = cellX(b[0]), x1 = cellX(b[2]);
+        int y0 = cellY(b[1]), y1 = cellY(b[3]);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                fn(static_cast<size_t>(y) * _columns + x);
+    };
+    for (size_t i = 0; i < count; ++i) {
+        const float* b = &bounds[i * 4];
+        if (!HasBox(b)) continue;
+        if (isLarge(b)) {
+            _large.push_back(static_cast<std::uint32_t>(i));
+            _filed[i] = Filed::Large;
+            continue;
+        }
+        forEachCell(b, [&](size_t cell) { ++_cellStart[cell + 1]; });
+        _filed[i] = Filed::Cells;
+        std::uint16_t* rect = &_cellRect[i * 4];
+        rect[0] = static_cast<std::uint16_t>(cellX(b[0]));
+        rect[1] = static_cast<std::uint16_t>(cellY(b[1]));
+        rect[2] = static_cast<std::uint16_t>(cellX(b[2]));
+        rect[3] = static_cast<std::uint16_t>(cellY(b[3]));
+    }
+    for (size_t c = 0; c < cellCount; ++c)
+        _cellStart[c + 1] += _cellStart[c];
+
+    _cellItems.resize(_cellStart[cellCount]);
+    std::vector<std::uint32_t> fill(_cellStart.begin(), _cellStart.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        const float* b = &bounds[i * 4];
+        if (_filed[i] != Filed::Cells) continue;
+        forEachCell(b, [&](size_t cell) { _cellItems[fill[cell]++] = static_cast<std::uint32_t>(i); });
+    }
+}
+
+void TileGrid::update()
+{
+    if (!_bounds) return;
+    const size_t count = _bounds->size() / 4;
+    _filed.resize(count, Filed::None);
+    _cellRect.resize(count * 4, 0);
+    for (size_t i = _count; i < count; ++i) {
+        if (HasBox(&(*_bounds)[i * 4]))
+            addToTail(static_cast<std::uint32_t>(i));
+    }
+    _count = count;
+    if (_tail.size() > std::max(kMinTail, _built / kTailFraction))
+        build(*_bounds);
+}
+
+void TileGrid::move(std::uint32_t id)
+{
+    if (!_bounds || id >= _count || _filed[id] == Filed::Tail) return;
+    const float* b = &(*_bounds)[id * 4];
+    if (!HasBox(b)) {
+        _filed[id] = Filed::None;
+        return;
+    }
+
+    // Still listed where a query would look for it
+    if (_columns > 0) {
+        if (_filed[id] == Filed::Large && isLarge(b)) {
+            Grow(_reach, b);
+            return;
+        }
+        const std::uint16_t* rect = &_cellRect[id * 4];
+        if (_filed[id] == Filed::Cells && !isLarge(b)
+            && rect[0] == cellX(b[0]) && rect[1] == cellY(b[1]) && rect[2] == cellX(b[2]) && rect[3] == cellY(b[3])) {
+            Grow(_reach, b);
+            return;
+        }
+    }
+
+    addToTail(id);
+    if (_tail.size() > std::max(kMinTail, _built / kTailFraction))
+        build(*_bounds);
+}
+
+void TileGrid::query(float minX, float minY, float maxX, float maxY, std::vector<std::uint32_t>& out) const
+{
+    if (!_bounds) return;
+    const std::vector<float>& bounds = *_bounds;
+    auto overlaps = [&](const float* b) {
+        return b[0] <= maxX && b[2] >= minX && b[1] <= maxY && b[3] >= minY;
+    };
+
+    for (std::uint32_t id : _large) {
+        if (_filed[id] == Filed::Large && overlaps(&bounds[id * 4])) out.push_back(id);
+    }
+    for (std::uint32_t id : _tail) {
+        const float* b = &bounds[id * 4];
+        if (_filed[id] == Filed::Tail && HasBox(b) && overlaps(b)) out.push_back(id);
+    }
+
+    // Boxes that moved within their cells may stick out of the cell extent
+    if (_columns == 0 || maxX < _reach[0] || minX > _reach[2] || maxY < _reach[1] || minY > _reach[3])
+        return;
+    int qx0 = cellX(minX), qx1 = cellX(maxX);
+    int qy0 = cellY(minY), qy1 = cellY(maxY);
+    for (int y = qy0; y <= qy1; ++y) {
+        for (int x = qx0; x <= qx1; ++x) {
+            size_t cell = static_cast<size_t>(y) * _columns + x;
+            for (std::uint32_t i = _cellStart[cell]; i < _cellStart[cell + 1]; ++i) {
+                std::uint32_t id = _cellItems[i];
+                const float* b = &bounds[id * 4];
+                if (_filed[id] != Filed::Cells || !overlaps(b)) continue;
+                // Report from the first cell shared by the box and the query only
+                const std::uint16_t* rect = &_cellRect[id * 4];
+                if (x != std::max<int>(rect[0], qx0) || y != std::max<int>(rect[1], qy0)) continue;
+                out.push_back(id);
+            }
+        }
+    }
+}
+
+bool TileGrid::covers(float minX, float minY, float maxX, float maxY) const
+{
+    return !HasBox(_reach) ||
+        (minX <= _reach[0] && minY <= _reach[1] && maxX >= _reach[2] && maxY >= _reach[3]);
+}
@@ -0,0 +1,194 @@
+// Headless batch splitter: loads every DXF in a directory, splits it by a
+// cutter layer the way the Split action does and writes the pieces.
+// Files are processed in parallel, one per worker thread.
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AutoDxfHelper.h"
+#include "Dxfloader.h"
+#include "DxfWriter.h"
+#include "MemoryStats.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Options {
+    fs::path inputDir;
+    fs::path outputDir;
+    std::string cutterLayer = "1";
+    unsigned jobs = 0; // 0 = one per core
+};
+
+void PrintUsage()
+{
+    std::cerr << "Usage: AutoDxfBatch <input-dir> <output-dir> [--layer NAME] [--jobs N]\n"
+                 "Splits every *.dxf in input-dir by the polylines on the cutter layer\n"
+                 "(default \"1\") and writes <name>_split.dxf to output-dir.\n";
+}
+
+bool ParseArgs(int argc, char* argv[], Options& options)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--layer" && i + 1 < argc) {
+            options.cutterLayer = argv[++i];
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        }
+        else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != 2)
+        return false;
+    options.inputDir = positional[0];
+    options.outputDir = positional[1];
+    return true;
+}
+
+struct FileResult {
+    bool ok = false;
+    std::string error;
+    double loadMs = 0.0, splitMs = 0.0, writeMs = 0.0;
+    size_t entityCount = 0;
+    size_t cutterCount = 0, targetCount = 0;
+    size_t intersectionCount = 0, pieceCount = 0;
+    std::uint64_t loadAllocations = 0;
+    size_t arenaBytes = 0;
+};
+
+FileResult ProcessFile(const fs::path& input, const fs::path& output, const std::string& cutterLayer)
+{
+    FileResult result;
+
+    auto start = Clock::now();
+    DxfLoader loader;
+    // Nothing is drawn, so curves only need the minimum tessellation
+    loader.setChordTolerance(std::numeric_limits<float>::max());
+    loader.setTessellationThreads(1); // files already run one per core
+    if (!loader.load(input.string())) {
+        result.error = "load failed";
+        return result;
+    }
+    std::vector<std::shared_ptr<Entity>> entities = loader.getEntities();
+    result.loadMs = MsSince(start);
+    result.entityCount = entities.size();
+    result.loadAllocations = loader.getReport().allocationCount;
+    result.arenaBytes = loader.getReport().arenaBytes;
+
+    start = Clock::now();
+    auto split = AutoDxfHelper::SplitByCutterLayer(entities, cutterLayer);
+    result.splitMs = MsSince(start);
+    result.cutterCount = split.cutterCount;
+    result.targetCount = split.targetCount;
+    result.intersectionCount = split.intersections.size();
+    result.pieceCount = split.polylines.size();
+
+    start = Clock::now();
+    std::vector<std::shared_ptr<Entity>> pieces(split.polylines.begin(), split.polylines.end());
+    DxfWriter writer(pieces);
+    if (!writer.write(output.string())) {
+        result.error = "write failed";
+        return result;
+    }
+    result.writeMs = MsSince(start);
+
+    result.ok = true;
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::error_code ec;
+    std::vector<fs::path> inputs;
+    for (const auto& entry : fs::directory_iterator(options.inputDir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (entry.is_regular_file() && ext == ".dxf")
+            inputs.push_back(entry.path());
+    }
+    if (ec) {
+        std::cerr << "Cannot read " << options.inputDir.string() << ": " << ec.message() << "\n";
+        return 1;
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    fs::create_directories(options.outputDir, ec);
+    if (ec) {
+        std::cerr << "Cannot create " << options.outputDir.string() << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<unsigned>(jobs, static_cast<unsigned>(std::max<size_t>(1, inputs.size())));
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::mutex outputMutex;
+    auto batchStart = Clock::now();
+
+    // Files are handed out one at a time, so large and small files balance out
+    auto worker = [&]() {
+        for (size_t i = next++; i < inputs.size(); i = next++) {
+            const fs::path& input = inputs[i];
+            fs::path output = options.outputDir / (input.stem().string() + "_split.dxf");
+            FileResult r = ProcessFile(input, output, options.cutterLayer);
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (!r.ok) {
+                ++failed;
+                std::cerr << input.filename().string() << ": " << r.error << "\n";
+                continue;
+            }
+            std::cout << input.filename().string()
+                << ": load " << r.loadMs << " ms, split " << r.splitMs << " ms, write " << r.writeMs << " ms | "
+                << r.entityCount << " entities, " << r.cutterCount << " cutters, "
+                << r.targetCount << " polylines, " << r.intersectionCount << " intersections -> "
+                << r.pieceCount << " pieces | " << r.loadAllocations << " allocs, arena "
+                << r.arenaBytes / 1024 << " KB\n";
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(jobs);
+    for (unsigned t = 0; t < jobs; ++t)
+        threads.emplace_back(worker);
+    for (auto& thread : threads)
+        thread.join();
+
+    std::cout << inputs.size() << " files, " << failed.load() << " failed, "
+        << jobs << " threads, " << MsSince(batchStart) << " ms total, peak RSS "
+        << MemoryStats::peakResidentBytes() / (1024 * 1024) << " MB\n";
+    return failed.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Headless thumbnails: renders every DXF in a directory to a PNG, zoomed to
+// extents. Files are loaded and tessellated on worker threads, one per core;
+// a single offscreen OpenGL context on the main thread rasterizes them in the
+// order they finish. With --software, Mesa's llvmpipe on Linux or Qt's
+// opengl32sw on Windows stands in for a missing GPU.
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <QColor>
+#include <QGuiApplication>
+#include <QImage>
+#include "Dxfloader.h"
+#include "MemoryStats.h"
+#include "OffscreenRenderer.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Options {
+    fs::path inputDir;
+    fs::path outputDir;
+    int width = 512;
+    int height = 512;
+    std::string background = "#000000";
+    unsigned jobs = 0; // 0 = one per core
+    bool software = false;
+};
+
+void PrintUsage()
+{
+    std::cerr << "Usage: AutoDxfThumbs <input-dir> <output-dir> [--size WxH] [--background #RRGGBB]\n"
+                 "                     [--jobs N] [--software]\n"
+                 "Renders every *.dxf in input-dir zoomed to extents and writes <name>.png\n"
+                 "(default 512x512) to output-dir. --software renders without a GPU.\n";
+}
+
+bool ParseArgs(int argc, char* argv[], Options& options)
+{
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            std::string size = argv[++i];
+            size_t x = size.find_first_of("xX");
+            if (x == std::string::npos) return false;
+            options.width = std::atoi(size.substr(0, x).c_str());
+            options.height = std::atoi(size.substr(x + 1).c_str());
+            if (options.width <= 0 || options.height <= 0) return false;
+        }
+        else if (arg == "--background" && i + 1 < argc) {
+            options.background = argv[++i];
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--software") {
+            options.software = true;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            return false;
+        }
+        else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != 2)
+        return false;
+    options.inputDir = positional[0];
+    options.outputDir = positional[1];
+    return true;
+}
+
+struct LoadedFile {
+    size_t index = 0;
+    bool ok = false;
+    std::string error;
+    double loadMs = 0.0;
+    std::vector<std::shared_ptr<Entity>> entities;
+    LayerTable layers;
+};
+
+// Loaded drawings waiting for the GL thread. Bounded, so the loaders cannot
+// run far ahead of rasterization with many drawings held in memory.
+class LoadQueue
+{
+public:
+    explicit LoadQueue(size_t capacity) : _capacity(capacity) {}
+
+    void push(LoadedFile file) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [this] { return _files.size() < _capacity; });
+        _files.push_back(std::move(file));
+        _notEmpty.notify_one();
+    }
+
+    LoadedFile pop() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [this] { return !_files.empty(); });
+        LoadedFile file = std::move(_files.front());
+        _files.pop_front();
+        _notFull.notify_one();
+        return file;
+    }
+
+private:
+    size_t _capacity;
+    std::mutex _mutex;
+    std::condition_variable _notFull, _notEmpty;
+    std::deque<LoadedFile> _files;
+};
+
+LoadedFile LoadFile(size_t index, const fs::path& input, const QSize& size)
+{
+    LoadedFile result;
+    result.index = index;
+
+    auto start = Clock::now();
+    DxfLoader loader;
+    // Curves, block members included, are tessellated below once the zoom of
+    // the image is known
+    loader.setChordTolerance(std::numeric_limits<float>::max());
+    loader.setTessellationThreads(1); // files already run one per core
+    if (!loader.load(input.string())) {
+        result.error = "load failed";
+        return result;
+    }
+    result.entities = loader.getEntities();
+    result.layers = loader.getLayers();
+    OffscreenRenderer::tessellateFor(result.entities, size);
+    result.loadMs = MsSince(start);
+    result.ok = true;
+    return result;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseArgs(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+
+    // A server has no display; an explicit QT_QPA_PLATFORM still wins
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    if (options.software) {
+        QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+    }
+    QGuiApplication app(argc, argv);
+
+    const QColor background(QString::fromStdString(options.background));
+    if (!background.isValid()) {
+        std::cerr << "Invalid background color " << options.background << "\n";
+        return 2;
+    }
+
+    std::error_code ec;
+    std::vector<fs::path> inputs;
+    for (const auto& entry : fs::directory_iterator(options.inputDir, ec)) {
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (entry.is_regular_file() && ext == ".dxf")
+            inputs.push_back(entry.path());
+    }
+    if (ec) {
+        std::cerr << "Cannot read " << options.inputDir.string() << ": " << ec.message() << "\n";
+        return 1;
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    fs::create_directories(options.outputDir, ec);
+    if (ec) {
+        std::cerr << "Cannot create " << options.outputDir.string() << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    OffscreenRenderer renderer;
+    QString error;
+    if (!renderer.init(&error)) {
+        std::cerr << "Offscreen rendering unavailable: " << error.toStdString()
+            << (options.software ? "\n" : " (try --software)\n");
+        return 1;
+    }
+
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::min<unsigned>(jobs, static_cast<unsigned>(std::max<size_t>(1, inputs.size())));
+
+    const QSize size(options.width, options.height);
+    std::atomic<size_t> next{ 0 };
+    LoadQueue queue(2 * static_cast<size_t>(jobs));
+    auto batchStart = Clock::now();
+
+    // Files are handed out one at a time, so large and small files balance out
+    auto loader = [&]() {
+        for (size_t i = next++; i < inputs.size(); i = next++)
+            queue.push(LoadFile(i, inputs[i], size));
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(jobs);
+    for (unsigned t = 0; t < jobs; ++t)
+        threads.emplace_back(loader);
+
+    // The GL context belongs to this thread; drawings are rasterized as they arrive
+    size_t failed = 0;
+    for (size_t done = 0; done < inputs.size(); ++done) {
+        LoadedFile file = queue.pop();
+        const fs::path& input = inputs[file.index];
+        if (!file.ok) {
+            ++failed;
+            std::cerr << input.filename().string() << ": " << file.error << "\n";
+            continue;
+        }
+
+        auto start = Clock::now();
+        QImage image = renderer.render(file.entities, file.layers, size, background);
+        double renderMs = MsSince(start);
+        // Free the drawing before encoding, the image is all that is left to do
+        size_t entityCount = file.entities.size();
+        file.entities.clear();
+
+        start = Clock::now();
+        fs::path output = options.outputDir / (input.stem().string() + ".png");
+        if (image.isNull() || !image.save(QString::fromStdU16String(output.u16string()), "PNG")) {
+            ++failed;
+            std::cerr << input.filename().string() << ": " << (image.isNull() ? "render failed" : "write failed") << "\n";
+            continue;
+        }
+        std::cout << input.filename().string()
+            << ": load " << file.loadMs << " ms, render " << renderMs << " ms, write " << MsSince(start)
+            << " ms | " << entityCount << " entities\n";
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    std::cout << inputs.size() << " files, " << failed << " failed, "
+        << jobs << " loader threads, " << MsSince(batchStart) << " ms total, peak RSS "
+        << MemoryStats::peakResidentBytes() / (1024 * 1024) << " MB\n";
+    return failed == 0 ? 0 : 1;
+}
@@ -1,18 +1,50 @@
 #include "myqopenglwidget.h"
 #include <QOpenGLContext>
 #include <QOpenGLVersionFunctionsFactory>
-#include "Entities/Circle.h"
+#include <QElapsedTimer>
+#include <QToolTip>
+#include <algorithm>
+#include "SceneCache.h"
 //Q_DECLARE_METATYPE(std::shared_ptr<Entity>)
 
+// GUI-thread budget per upload batch, so the event loop stays responsive
+static constexpr qint64 kUploadSliceMs = 12;
+// Entities per chunk handed from the parser to the viewer
+static constexpr size_t kChunkSize = 4096;
+// Hover picks at most this often while the mouse moves
+static constexpr int kHoverIntervalMs = 30;
+
 MyQOpenGLWidget::MyQOpenGLWidget(QWidget* parent)
     : QOpenGLWidget(parent),
     m_renderer(nullptr)
 {
     setMouseTracking(true);
+    m_rubberBand = new QRubberBand(QRubberBand::Rectangle, this);
+
+    m_statsLabel = new QLabel(this);
+    m_statsLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_statsLabel->setStyleSheet("QLabel { background: rgba(0, 0, 0, 160); color: #e0e0e0; padding: 4px; font-family: monospace; }");
+    m_statsLabel->move(8, 8);
+    m_statsLabel->hide();
+
+    m_uploadTimer = new QTimer(this);
+    m_uploadTimer->setInterval(0);
+    connect(m_uploadTimer, &QTimer::timeout, this, &MyQOpenGLWidget::uploadPendingBatch);
+
+    m_tessApplyTimer = new QTimer(this);
+    m_tessApplyTimer->setInterval(0);
+    connect(m_tessApplyTimer, &QTimer::timeout, this, &MyQOpenGLWidget::applyTessellationBatch);
+
+    m_hoverTimer = new QTimer(this);
+    m_hoverTimer->setSingleShot(true);
+    m_hoverTimer->setInterval(kHoverIntervalMs);
+    connect(m_hoverTimer, &QTimer::timeout, this, &MyQOpenGLWidget::updateHover);
 }
 
 MyQOpenGLWidget::~MyQOpenGLWidget()
 {
+    stopLoading();
+    stopTessellation();
     makeCurrent();
     m_renderer.reset();// can only delete gl-related objects here
     doneCurrent();
@@ -45,6 +77,7 @@ void MyQOpenGLWidget::resizeGL(int w, int h)
 
     if (m_renderer) {
         m_renderer->resize(w, h, f);
+        updateTessellation(); // a larger view may show entities not done yet
     }
 }
 
@@ -57,11 +90,43 @@ void MyQOpenGLWidget::paintGL()
 
     if (m_renderer) {
         m_renderer->render(f);
+        if (m_statsLabel->isVisible() && (!m_statsRefresh.isValid() || m_statsRefresh.elapsed() >= kStatsRefreshMs))
+            updateFrameStatsLabel();
+    }
+}
+
+void MyQOpenGLWidget::setFrameStatsVisible(bool visible)
+{
+    m_statsLabel->setVisible(visible);
+    if (visible && m_renderer) {
+        m_renderer->resetFrameStats();
+        m_statsRefresh.invalidate();
+        update();
     }
 }
 
+void MyQOpenGLWidget::updateFrameStatsLabel()
+{
+    const FrameStats::Summary s = m_renderer->getFrameStats().summarize();
+    auto mb = [](size_t bytes) { return QString::number(bytes / (1024.0 * 1024.0), 'f', 1); };
+    auto ms = [](double value) { return value < 0.0 ? QStringLiteral("-") : QString::number(value, 'f', 2); };
+
+    QStringList lines;
+    lines << QString("fps %1   frame p50 %2 ms  p99 %3 ms").arg(s.fps, 0, 'f', 1).arg(ms(s.frameP50Ms), ms(s.frameP99Ms));
+    lines << QString("cpu %1 ms: upload %2  cull %3  batch %4  submit %5").arg(ms(s.cpuTotalMs),
+        ms(s.cpuMs[FrameStats::Upload]), ms(s.cpuMs[FrameStats::Cull]),
+        ms(s.cpuMs[FrameStats::Batch]), ms(s.cpuMs[FrameStats::Submit]));
+    lines << QString("gpu p50 %1 ms  p99 %2 ms").arg(ms(s.gpuP50Ms), ms(s.gpuP99Ms));
+    lines << QString("draws %1  vertices %2").arg(s.drawCalls, 0, 'f', 0).arg(s.vertices, 0, 'f', 0);
+    lines << QString("buffers %1 MB  targets %2 MB").arg(mb(m_renderer->getGpuBufferBytes()), mb(m_renderer->getGpuTargetBytes()));
+    m_statsLabel->setText(lines.join('\n'));
+    m_statsLabel->adjustSize();
+    m_statsRefresh.start();
+}
+
 void MyQOpenGLWidget::loadDxf(const QString& fileName)
 {
+    stopLoading(); // a new load supersedes the one in flight
 	OnClearDxf(); // Clear existing entities
     if (!m_renderer)
     {
@@ -69,49 +134,385 @@ void MyQOpenGLWidget::loadDxf(const QString& fileName)
     }
 
     m_loadedFilePath = fileName;
+    m_cancelLoad = false;
+    m_parseDone = false;
+    m_loadReport = DxfLoadReport{};
+    const quint64 generation = ++m_loadGeneration;
+    // Tessellate for the current zoom right away
+    m_tessLevel = m_renderer->getLodLevel();
+    const float chordTolerance = Render2D::getChordTolerance(m_tessLevel);
+    std::string path = fileName.toLocal8Bit().constData(); // Window Chinese Character Friendly 
+
+    // The tree is shown right away and grows with every parsed chunk
+    QStandardItemModel* model = new QStandardItemModel(nullptr);
+    model->appendRow(new QStandardItem("Dxf Entities"));
+    m_treeModel = model;
+    emit UpdateTreeModel(model);
+
+    // Parsing, tessellation and the tree item build run on the worker thread
+    m_loadThread = QThread::create([this, path, generation, chordTolerance]() {
+        int entityIndex = 0;
+        double treeBuildMs = 0.0;
+        LayerTable cachedLayers;
+        const LayerTable* layerSource = &cachedLayers;
+
+        // Hands one chunk to the GUI thread for upload and display
+        auto publish = [this, generation, &entityIndex, &treeBuildMs, &layerSource](std::vector<std::shared_ptr<Entity>> chunk) {
+            // The layer table precedes the entities, so hidden layers never show up
+            std::shared_ptr<const LayerTable> layers;
+            if (entityIndex == 0)
+                layers = std::make_shared<const LayerTable>(*layerSource);
+
+            QElapsedTimer treeTimer;
+            treeTimer.start();
+            QList<QStandardItem*> items;
+            items.reserve(chunk.size());
+            for (const auto& entity : chunk) {
+                // Display as "Entity{index}" in the tree
+                QString itemName = QString("%1%2").arg(entity.get()->getType()).arg(entityIndex++);
+
+                QStandardItem* entityItem = new QStandardItem(itemName);
+
+                // Store the shared pointer in the item using QVariant
+                entityItem->setData(QVariant::fromValue(entity), Qt::UserRole);
+                items.push_back(entityItem);
+            }
+            treeBuildMs += treeTimer.nsecsElapsed() / 1e6;
+
+            QMetaObject::invokeMethod(this, [this, generation, chunk, items, layers]() {
+                onChunkParsed(generation, chunk, items, layers);
+            }, Qt::QueuedConnection);
+        };
+
+        std::vector<std::shared_ptr<Entity>> entities;
+        DxfLoadReport report;
+
+        // A cache hit skips DxfLoader entirely
+        bool ok = SceneCache::load(path, entities, cachedLayers, report) && !m_cancelLoad.load();
+        if (ok) {
+            for (size_t i = 0; i < entities.size(); i += kChunkSize) {
+                size_t end = std::min(entities.size(), i + kChunkSize);
+                publish(std::vector<std::shared_ptr<Entity>>(entities.begin() + i, entities.begin() + end));
+            }
+        }
+        std::shared_ptr<const LayerTable> layers;
+        if (ok) {
+            layers = std::make_shared<const LayerTable>(cachedLayers);
+        }
+        else {
+            DxfLoader loader;
+            layerSource = &loader.getLayers();
+            loader.setChordTolerance(chordTolerance);
+            loader.setProgressCallback([this](std::uint64_t bytesRead, std::uint64_t totalBytes) {
+                emit LoadProgress(static_cast<qint64>(bytesRead), static_cast<qint64>(totalBytes));
+                return !m_cancelLoad.load();
+            });
+            loader.setChunkCallback(publish, kChunkSize);
+
+            ok = loader.load(path);
+            report = loader.getReport();
+            report.parseMs -= treeBuildMs; // items are built from inside the parse
+            layers = std::make_shared<const LayerTable>(loader.getLayers());
+            if (ok) SceneCache::save(path, loader.getEntities(), loader.getBlocks(), loader.getLayers(), report);
+        }
+        report.treeBuildMs = treeBuildMs;
 
-    makeCurrent();  // IMPORTANT: ensure GL context is current
+        QMetaObject::invokeMethod(this, [this, generation, ok, report, layers]() {
+            onDxfParsed(generation, ok, report, layers);
+        }, Qt::QueuedConnection);
+    });
+    m_loadThread->start();
+}
 
-    // Ask for the 3.3 Core functions for the current context
-    auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(context());
-    if (!f) {
-        qFatal("Failed to get OpenGL 3.3 core functions");
+void MyQOpenGLWidget::onChunkParsed(quint64 generation, const std::vector<std::shared_ptr<Entity>>& chunk,
+    const QList<QStandardItem*>& items, const std::shared_ptr<const LayerTable>& layers)
+{
+    if (generation != m_loadGeneration || !m_treeModel) {
+        // Chunk of a load that was cancelled or superseded
+        qDeleteAll(items);
         return;
     }
 
-    DxfLoader loader;
-    std::string path = fileName.toLocal8Bit().constData(); // Window Chinese Character Friendly 
-    if (loader.load(path)) {
-        for (auto& entity : loader.getEntities()) {
-            entity->createBuffers(f);
-            m_renderer->addEntity(entity);
-        }
+    if (layers && m_renderer)
+        m_renderer->setLayers(*layers);
+    m_pendingUpload.insert(m_pendingUpload.end(), chunk.begin(), chunk.end());
+    m_treeModel->item(0)->appendRows(items);
+
+    // GL upload happens on the GUI thread, a time slice at a time
+    if (!m_uploadTimer->isActive())
+        m_uploadTimer->start();
+}
+
+void MyQOpenGLWidget::onDxfParsed(quint64 generation, bool ok, const DxfLoadReport& report,
+    const std::shared_ptr<const LayerTable>& layers)
+{
+    if (generation != m_loadGeneration) {
+        // Result of a load that was cancelled or superseded
+        return;
+    }
+
+    if (m_loadThread) {
+        m_loadThread->wait(); // already returning, just join it
+        delete m_loadThread;
+        m_loadThread = nullptr;
+    }
+
+    if (!ok) {
+        // Drop whatever part of the drawing was already shown
+        stopLoading();
+        OnClearDxf();
+        emit LoadFinished(false);
+        return;
+    }
+
+    if (layers && m_renderer)
+        m_renderer->setLayers(*layers); // also layers without entities
+    double uploadMs = m_loadReport.uploadMs; // accumulated while parsing
+    m_loadReport = report;
+    if (report.fromCache)
+        m_tessLevel = kStaleTessLevel; // cached at whatever zoom the drawing was saved
+    m_loadReport.uploadMs = uploadMs;
+    m_parseDone = true;
+    if (!m_uploadTimer->isActive())
+        uploadPendingBatch(); // everything already uploaded, just finish
+}
+
+void MyQOpenGLWidget::uploadPendingBatch()
+{
+    if (!m_renderer) {
+        stopLoading();
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    while (m_uploadIndex < m_pendingUpload.size()) {
+        m_renderer->addEntity(m_pendingUpload[m_uploadIndex++]);
 
-        // update draw
-		update();
-        // update tree view
-        QStandardItemModel* model = new QStandardItemModel(nullptr);
-        // Build the model
-        QStandardItem* dxfItem = new QStandardItem("Dxf Entities");
-        auto entities = loader.getEntities();
-        for (int i = 0; i < entities.size(); ++i) {
-            const auto& entity = entities[i];
+        // elapsed() is cheap but not free, poll it every few entities
+        if ((m_uploadIndex & 0xFF) == 0 && slice.elapsed() >= kUploadSliceMs)
+            break;
+    }
+    // Upload time is the GUI-thread time spent in slices, not the span between them
+    m_loadReport.uploadMs += slice.nsecsElapsed() / 1e6;
+
+    // update draw
+    update();
+
+    if (m_uploadIndex < m_pendingUpload.size())
+        return;
+
+    // Caught up with the parser
+    m_uploadTimer->stop();
+    m_pendingUpload.clear();
+    m_uploadIndex = 0;
+
+    if (m_parseDone) {
+        m_parseDone = false;
+        emit LoadFinished(true);
+        updateTessellation(); // the view may have been zoomed while loading
+    }
+}
+
+bool MyQOpenGLWidget::stopLoading()
+{
+    bool wasLoading = isLoading();
+
+    ++m_loadGeneration;
+    if (m_loadThread) {
+        m_cancelLoad = true;
+        m_loadThread->wait();
+        delete m_loadThread;
+        m_loadThread = nullptr;
+    }
+
+    m_uploadTimer->stop();
+    m_pendingUpload.clear();
+    m_uploadIndex = 0;
+    m_parseDone = false;
+
+    return wasLoading;
+}
 
-            // Display as "Entity{index}" in the tree
-            QString itemName = QString("%1%2").arg(entity.get()->getType()).arg(i);
+void MyQOpenGLWidget::OnCancelLoad()
+{
+    if (!stopLoading())
+        return;
 
-            QStandardItem* entityItem = new QStandardItem(itemName);
+    // Drop whatever part of the drawing was already uploaded
+    OnClearDxf();
+    emit LoadFinished(false);
+}
 
-            // Store the shared pointer in the item using QVariant
-            entityItem->setData(QVariant::fromValue(entity), Qt::UserRole);
+void MyQOpenGLWidget::updateTessellation()
+{
+    // One job at a time; it checks the level again when it is done
+    if (!m_renderer || isLoading() || m_tessThread || m_tessApplyTimer->isActive())
+        return;
 
-            dxfItem->appendRow(entityItem);
+    // Entities added since the last job were tessellated at m_tessLevel
+    const auto& all = m_renderer->getEntities();
+    m_entityTessLevels.resize(all.size(), m_tessLevel);
+
+    const int level = m_renderer->getLodLevel();
+    float view[4];
+    m_renderer->getViewRect(view);
+    if (level == m_tessLevel && view[0] >= m_tessRect[0] && view[1] >= m_tessRect[1]
+        && view[2] <= m_tessRect[2] && view[3] <= m_tessRect[3])
+        return;
+
+    // The view and half a view around it, so small pans need no new job
+    const float marginX = 0.5f * (view[2] - view[0]);
+    const float marginY = 0.5f * (view[3] - view[1]);
+    m_tessRect[0] = view[0] - marginX;
+    m_tessRect[1] = view[1] - marginY;
+    m_tessRect[2] = view[2] + marginX;
+    m_tessRect[3] = view[3] + marginY;
+    m_tessLevel = level;
+    m_cancelTess = false;
+    const float chordTolerance = Render2D::getChordTolerance(level);
+    const quint64 generation = ++m_tessGeneration;
+
+    // Entities in the area not at this level yet, and every insert there for its block
+    std::vector<SceneStore::EntityId> ids;
+    m_renderer->queryEntityIds(m_tessRect[0], m_tessRect[1], m_tessRect[2], m_tessRect[3], ids);
+    std::vector<std::shared_ptr<Entity>> entities;
+    std::vector<std::shared_ptr<Entity>> inserts;
+    for (SceneStore::EntityId id : ids) {
+        if (dynamic_cast<const Insert*>(all[id].get())) {
+            inserts.push_back(all[id]);
+        }
+        else if (m_entityTessLevels[id] != level) {
+            entities.push_back(all[id]);
+            m_entityTessLevels[id] = level;
+        }
+    }
+
+    // The worker only reads the analytic curve data, vertices are swapped on the GUI thread
+    m_tessThread = QThread::create([this, entities = std::move(entities), inserts = std::move(inserts),
+        blockTolerances = m_blockTolerances, chordTolerance, generation]() {
+        TessellationResult results;
+        std::vector<float> vertices;
+        for (const auto& entity : entities) {
+            if (m_cancelTess.load())
+                return;
+            if (!Render2D::drawsAnalytically(*entity) && entity->tessellate(chordTolerance, vertices)) {
+                std::vector<Entity::LodLevel> lodLevels = entity->makeLodLevels(vertices);
+                results.entities.push_back({ entity, std::move(vertices), std::move(lodLevels) });
+            }
+        }
+
+        // Members of blocks are drawn flattened into the block, whatever kind they are
+        const auto blockScales = Render2D::getBlockScales(inserts);
+        for (const auto& [block, blockScale] : blockScales) {
+            const float blockTolerance = blockScale > 0.0f ? chordTolerance / blockScale : chordTolerance;
+            auto done = blockTolerances.find(block);
+            if (done != blockTolerances.end() && done->second == blockTolerance)
+                continue;
+            for (const auto& member : block->getEntities()) {
+                if (m_cancelTess.load())
+                    return;
+                if (member->tessellate(blockTolerance, vertices)) {
+                    std::vector<Entity::LodLevel> lodLevels = member->makeLodLevels(vertices);
+                    results.blockMembers.push_back({ member, std::move(vertices), std::move(lodLevels) });
+                }
+            }
+            results.blockTolerances.emplace_back(block, blockTolerance);
+        }
+        if (!results.blockTolerances.empty()) {
+            for (const auto& [block, blockScale] : blockScales)
+                results.blocks.push_back(block);
         }
-		model->appendRow(dxfItem);
-		emit UpdateTreeModel(model);
+
+        QMetaObject::invokeMethod(this, [this, generation, results = std::move(results)]() mutable {
+            onTessellated(generation, std::move(results));
+        }, Qt::QueuedConnection);
+    });
+    m_tessThread->start();
+}
+
+void MyQOpenGLWidget::onTessellated(quint64 generation, TessellationResult results)
+{
+    if (generation != m_tessGeneration) {
+        // Scene was cleared or reloaded in the meantime
+        return;
+    }
+
+    if (m_tessThread) {
+        m_tessThread->wait(); // already returning, just join it
+        delete m_tessThread;
+        m_tessThread = nullptr;
+    }
+
+    m_pendingTess = std::move(results);
+    m_tessIndex = 0;
+    if (m_pendingTess.entities.empty() && m_pendingTess.blocks.empty())
+        updateTessellation();
+    else
+        m_tessApplyTimer->start();
+}
+
+void MyQOpenGLWidget::applyTessellationBatch()
+{
+    if (!m_renderer) {
+        stopTessellation();
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    while (m_tessIndex < m_pendingTess.entities.size()) {
+        auto& [entity, vertices, lodLevels] = m_pendingTess.entities[m_tessIndex++];
+        entity->setVertices(std::move(vertices), std::move(lodLevels));
+        m_renderer->updateEntity(entity.get());
+
+        if ((m_tessIndex & 0xFF) == 0 && slice.elapsed() >= kUploadSliceMs)
+            break;
+    }
+    update();
+
+    if (m_tessIndex < m_pendingTess.entities.size())
+        return;
+
+    // Blocks in one go: nested blocks flatten their children, so all members
+    // must be in before any block is rebuilt
+    if (!m_pendingTess.blocks.empty()) {
+        for (auto& [member, vertices, lodLevels] : m_pendingTess.blockMembers)
+            member->setVertices(std::move(vertices), std::move(lodLevels));
+        for (BlockDefinition* block : m_pendingTess.blocks)
+            block->invalidate();
+        for (BlockDefinition* block : m_pendingTess.blocks)
+            block->build();
+        for (const auto& [block, tolerance] : m_pendingTess.blockTolerances)
+            m_blockTolerances[block] = tolerance;
+        m_renderer->updateBlockGeometry(m_pendingTess.blocks);
+        update();
+    }
+
+    m_tessApplyTimer->stop();
+    m_pendingTess = {};
+    m_tessIndex = 0;
+    updateTessellation(); // zoom may have moved on while this job ran
+}
+
+void MyQOpenGLWidget::stopTessellation()
+{
+    ++m_tessGeneration;
+    if (m_tessThread) {
+        m_cancelTess = true;
+        m_tessThread->wait();
+        delete m_tessThread;
+        m_tessThread = nullptr;
     }
 
-    doneCurrent();  // release context
+    m_tessApplyTimer->stop();
+    m_pendingTess = {};
+    m_tessIndex = 0;
+    m_tessLevel = kStaleTessLevel;
+    m_tessRect[0] = m_tessRect[1] = 0.0f;
+    m_tessRect[2] = m_tessRect[3] = -1.0f;
+    m_entityTessLevels.clear();
+    m_blockTolerances.clear();
 }
 
 void MyQOpenGLWidget::highlightSelectedEntity(Entity* selectedEntity)
@@ -120,6 +521,76 @@ void MyQOpenGLWidget::highlightSelectedEntity(Entity* selectedEntity)
     update();
 }
 
+Entity* MyQOpenGLWidget::pickEntityAt(const QPoint& pos)
+{
+    if (!m_renderer) return nullptr;
+
+    // While a load streams in, every chunk would redraw the whole id buffer
+    if (!isLoading()) {
+        makeCurrent();
+        Entity* entity = nullptr;
+        auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(context());
+        if (f) entity = m_renderer->pickEntity(f, pos, kPickRadiusPx);
+        doneCurrent();
+        if (f) return entity;
+    }
+    // No context yet or still loading: test the geometry on the CPU
+    glm::vec2 worldPos = m_renderer->getMouseWorldPos(pos);
+    double tolerance = kPickRadiusPx / m_renderer->getCameraScale();
+    return m_renderer->findEntityAtPoint(worldPos.x, worldPos.y, static_cast<float>(tolerance));
+}
+
+void MyQOpenGLWidget::updateHover()
+{
+    if (!m_renderer || m_panning || m_boxSelecting) return;
+
+    // Hover feedback only costs a redraw when the entity under the cursor changes
+    Entity* hovered = pickEntityAt(m_hoverPos);
+    if (hovered != m_hoveredEntity) {
+        m_hoveredEntity = hovered;
+        m_renderer->setHoveredEntity(hovered);
+        update();
+    }
+    // Markers sit on entities, so they are looked up on their own
+    glm::vec2 wpos = m_renderer->getMouseWorldPos(m_hoverPos);
+    setHoveredMarker(m_renderer->findMarkerAt(wpos.x, wpos.y, kPickRadiusPx), m_hoverGlobalPos);
+}
+
+void MyQOpenGLWidget::selectAt(const QPoint& pos, bool toggle)
+{
+    Entity* selectedEntity = pickEntityAt(pos);
+    if (toggle) {
+        // Ctrl+click toggles the entity in the selection
+        if (!selectedEntity) return;
+        m_renderer->setEntitySelected(selectedEntity, !m_renderer->isEntitySelected(selectedEntity));
+        update();
+    }
+    else {
+        highlightSelectedEntity(selectedEntity);
+    }
+    emit EntitySelected(selectedEntity);
+}
+
+void MyQOpenGLWidget::selectInBox(const QPoint& start, const QPoint& end, bool add)
+{
+    if (!m_renderer) return;
+
+    // Dragged to the right selects what lies inside the box,
+    // to the left whatever the box crosses
+    const bool crossing = end.x() < start.x();
+    glm::vec2 a = m_renderer->getMouseWorldPos(start);
+    glm::vec2 b = m_renderer->getMouseWorldPos(end);
+    std::vector<Entity*> entities = m_renderer->findEntitiesInRect(
+        std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y), crossing);
+
+    if (!add)
+        m_renderer->clearSelection();
+    for (Entity* entity : entities)
+        m_renderer->setEntitySelected(entity, true);
+    update();
+    emit EntitySelected(entities.size() == 1 ? entities.front() : nullptr);
+}
+
 void MyQOpenGLWidget::wheelEvent(QWheelEvent* event)
 {
     if (!m_renderer) return;
@@ -135,6 +606,7 @@ void MyQOpenGLWidget::wheelEvent(QWheelEvent* event)
     if (f) {
         m_renderer->handleZoom(delta, pos.x(), pos.y());
         update();  // Trigger repaint
+        updateTessellation();
     }
 
     event->accept();
@@ -150,13 +622,9 @@ void MyQOpenGLWidget::mousePressEvent(QMouseEvent* event)
     }
     else if (event->button() == Qt::LeftButton) 
     {
-        // find the entity that is clicked
-        glm::vec2 worldPos = m_renderer->getMouseWorldPos(event->pos());
-		double tolerance = 5.0f / m_renderer->getCameraScale(); // Adjust tolerance based on zoom level
-		Entity* selectedEntity = m_renderer->findEntityAtPoint(worldPos.x, worldPos.y, tolerance);
-		// Highlight the selected entity
-		highlightSelectedEntity(selectedEntity);
-        emit EntitySelected(selectedEntity);
+        // A click selects on release; dragging first turns it into a box selection
+        m_leftPressed = true;
+        m_boxStart = event->pos();
 		event->accept();
     }
     else {
@@ -184,8 +652,23 @@ void MyQOpenGLWidget::mouseMoveEvent(QMouseEvent* event)
 
         m_lastMousePos = currentPos;
         update();  // Trigger repaint
+        updateTessellation(); // entities panned into view may still be coarse
+        event->accept();
+    }
+    else if (m_leftPressed && (m_boxSelecting || (currentPos - m_boxStart).manhattanLength() > kDragThresholdPx)) {
+        m_boxSelecting = true;
+        m_rubberBand->setGeometry(QRect(m_boxStart, currentPos).normalized());
+        m_rubberBand->show();
         event->accept();
     }
+    else if (m_renderer) {
+        // Picked from the latest position when the timer runs out, not per event
+        m_hoverPos = currentPos;
+        m_hoverGlobalPos = event->globalPosition().toPoint();
+        if (!m_hoverTimer->isActive())
+            m_hoverTimer->start();
+        event->ignore();
+    }
     else {
         event->ignore();
     }
@@ -198,6 +681,19 @@ void MyQOpenGLWidget::mouseReleaseEvent(QMouseEvent* event)
         setCursor(Qt::ArrowCursor);
         event->accept();
     }
+    else if (event->button() == Qt::LeftButton && m_leftPressed) {
+        m_leftPressed = false;
+        const bool add = event->modifiers() & Qt::ControlModifier;
+        if (m_boxSelecting) {
+            m_boxSelecting = false;
+            m_rubberBand->hide();
+            selectInBox(m_boxStart, event->pos(), add);
+        }
+        else {
+            selectAt(event->pos(), add);
+        }
+        event->accept();
+    }
     else {
         event->ignore();
     }
@@ -208,22 +704,48 @@ const std::vector<std::shared_ptr<Entity>>& MyQOpenGLWidget::getEntities() const
     return m_renderer->getEntities();
 }
 
+const LayerTable& MyQOpenGLWidget::getLayers() const
+{
+    return m_renderer->getLayers();
+}
+
+void MyQOpenGLWidget::setLayerVisible(const QString& name, bool visible)
+{
+    if (!m_renderer) return;
+    m_renderer->setLayerVisible(name.toStdString(), visible);
+    update();
+}
+
+void MyQOpenGLWidget::isolateLayer(const QString& name)
+{
+    if (!m_renderer) return;
+    m_renderer->isolateLayer(name.toStdString());
+    update();
+}
+
+std::vector<std::shared_ptr<Entity>> MyQOpenGLWidget::getLayerEntities(const QString& name,
+    std::vector<std::shared_ptr<Entity>>* otherLayers) const
+{
+    if (!m_renderer) return {};
+    return m_renderer->getLayerEntities(name.toStdString(), otherLayers);
+}
+
 void MyQOpenGLWidget::addEntities(const std::vector<std::shared_ptr<Entity>>& entities)
 {
     if (!m_renderer || entities.empty())
         return;
 
-    makeCurrent();
-    auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(context());
-    if (!f) return;
-
+    // Match the tessellation of what is already on screen
+    int level = m_tessLevel == kStaleTessLevel ? m_renderer->getLodLevel() : m_tessLevel;
+    float chordTolerance = Render2D::getChordTolerance(level);
+    std::vector<float> vertices;
     for (auto& entity : entities) {
-        entity->createBuffers(f);
+        if (!Render2D::drawsAnalytically(*entity) && entity->tessellate(chordTolerance, vertices))
+            entity->setVertices(std::move(vertices));
         m_renderer->addEntity(entity);
     }
 
     update();
-    doneCurrent();
 }
 
 void MyQOpenGLWidget::addIntersectionPoints(const std::vector<glm::vec2>& points)
@@ -231,24 +753,34 @@ void MyQOpenGLWidget::addIntersectionPoints(const std::vector<glm::vec2>& points
     if (!m_renderer || points.empty())
         return;
 
-    makeCurrent();
-    auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(context());
-    if (!f) return;
+    m_renderer->addMarkers(points, kMarkerColor);
+    update();
+}
 
-    for (const auto& pt : points) {
-        auto marker = std::make_shared<Circle>(pt.x, pt.y, 0.5f, 16);
-        marker->setColor(1.0f, 1.0f, 0.0f); // Yellow
-        marker->setLayer("intersection");
-        marker->createBuffers(f);
-        m_renderer->addEntity(marker);
-    }
+void MyQOpenGLWidget::setHoveredMarker(size_t marker, const QPoint& globalPos)
+{
+    if (marker == m_hoveredMarker)
+        return;
 
+    if (m_hoveredMarker != Render2D::NO_MARKER)
+        m_renderer->setMarkerColor(m_hoveredMarker, kMarkerColor);
+    m_hoveredMarker = marker;
+    if (marker == Render2D::NO_MARKER) {
+        QToolTip::hideText();
+    }
+    else {
+        m_renderer->setMarkerColor(marker, kHoveredMarkerColor);
+        glm::vec2 p = m_renderer->getMarkerPosition(marker);
+        QToolTip::showText(globalPos, QString("Intersection %1, %2").arg(p.x, 0, 'f', 3).arg(p.y, 0, 'f', 3), this);
+    }
     update();
-    doneCurrent();
 }
 
 void MyQOpenGLWidget::OnClearDxf()
 {
+    if (stopLoading())
+        emit LoadFinished(false);
+    stopTessellation();
     if (!m_renderer)
         return;
 
@@ -257,6 +789,9 @@ void MyQOpenGLWidget::OnClearDxf()
     auto* f = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_3_3_Core>(context());
     if (f) {
         m_renderer->clearEntities(f);
+        m_hoverTimer->stop();
+        m_hoveredEntity = nullptr;
+        m_hoveredMarker = Render2D::NO_MARKER;
         update(); // Trigger repaint
     }
 